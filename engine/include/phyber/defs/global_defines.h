@@ -5,4 +5,9 @@
 
 typedef uint32_t color_precision_t;
 
+// used to pad data shared between threads so it doesn't false-share
+#ifndef PHYBER_ENGINE_CACHE_LINE_SIZE
+#define PHYBER_ENGINE_CACHE_LINE_SIZE 64
+#endif
+
 #endif /* PHYBER_ENGINE_GLOBAL_DEFINES_H */
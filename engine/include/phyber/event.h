@@ -1,8 +1,11 @@
 #ifndef PHYBER_ENGINE_EVENT_H
 #define PHYBER_ENGINE_EVENT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "phyber/utils/datatypes.h"
+
 namespace Phyber {
 
 typedef uint32_t EventType_t;
@@ -697,6 +700,23 @@ struct Event {
 };
 
 extern bool poll_event(Event &event);
+// opt-in, off by default. poll_events() merges consecutive MOUSE_MOTION
+// events with the same button state into one, with summed dx, dy and the
+// last x, y, and consecutive MOUSE_WHEEL events with the same direction
+// into one with summed amounts and the last mouse position. Events are
+// only merged within one poll_events() call
+extern void set_event_coalescing(bool enabled);
+extern bool is_event_coalescing();
+// every motion event of the last poll_events() call before merging, for
+// consumers that need the full path. Only filled while coalescing is on
+extern const DynamicArray<MouseMotionEvent> &raw_motion_samples();
+
+// pumps the OS event loop once and moves up to max queued events into out
+// in one pass, returns how many. Call once per frame, events left over stay
+// queued for the next call
+extern size_t poll_events(Event *out, size_t max);
+// appends every queued event to out, returns how many
+extern size_t poll_events(DynamicArray<Event> &out);
 
 }
 
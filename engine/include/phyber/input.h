@@ -0,0 +1,72 @@
+#ifndef PHYBER_ENGINE_INPUT_H
+#define PHYBER_ENGINE_INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "phyber/event.h"
+#include "phyber/utils/bitset.h"
+#include "phyber/utils/datatypes.h"
+
+namespace Phyber {
+
+// keyboard and mouse state of the current frame, built from the frame's
+// events. Every query is a single bit test or field read
+struct InputState {
+    typedef KeyboardEvent::KeySymbol::PhysicalKey Key;
+
+    static constexpr size_t KEY_COUNT = 512; // every physical key code is below this
+    typedef FixedBitSet<KEY_COUNT> KeySet;
+
+    KeySet keys;          // held at the end of this frame
+    KeySet previous_keys; // held at the end of the last frame
+    // went down / up during this frame. A key tapped within one frame is
+    // in both, even though it is not held at either end
+    KeySet pressed;
+    KeySet released;
+    KeyboardEvent::KeySymbol::KeyModifier modifiers = KeyboardEvent::KeySymbol::KMOD_NONE;
+
+    float mouse_x = 0, mouse_y = 0;   // relative to the window
+    float mouse_dx = 0, mouse_dy = 0; // summed over the frame
+    float wheel_x = 0, wheel_y = 0;   // summed over the frame, as SDL reports them
+    // bit (button - 1) for every MouseButtonFlags button, like SDL's masks
+    uint32_t buttons = 0;
+    uint32_t buttons_pressed = 0;
+    uint32_t buttons_released = 0;
+
+    bool quit = false; // a quit event arrived this frame
+
+    // keys from KEY_COUNT up and buttons outside 1..32 are never tracked,
+    // every query returns false for them
+    static constexpr bool valid_key(Key key) { return key < KEY_COUNT; }
+    static constexpr bool valid_button(MouseButtonFlags button) { return button >= 1 && button <= 32; }
+    static constexpr uint32_t button_bit(MouseButtonFlags button) { return uint32_t(1) << (button - 1); }
+
+    bool is_down(Key key) const { return valid_key(key) && keys.test(key); }
+    bool was_down(Key key) const { return valid_key(key) && previous_keys.test(key); }
+    bool was_pressed(Key key) const { return valid_key(key) && pressed.test(key); }
+    bool was_released(Key key) const { return valid_key(key) && released.test(key); }
+
+    bool is_down(MouseButtonFlags button) const { return valid_button(button) && (buttons & button_bit(button)); }
+    bool was_pressed(MouseButtonFlags button) const {
+        return valid_button(button) && (buttons_pressed & button_bit(button));
+    }
+    bool was_released(MouseButtonFlags button) const {
+        return valid_button(button) && (buttons_released & button_bit(button));
+    }
+
+    // keeps the held keys and buttons as the previous frame's, clears edges,
+    // deltas and quit
+    void begin_frame();
+    void apply(const Event &event);
+    // begin_frame() then apply() for every event
+    void update(const Event *events, size_t count);
+};
+
+// pumps the frame's events with poll_events(), appending them to events,
+// and updates the state with them. Returns the number of new events
+extern size_t poll_input(InputState &state, DynamicArray<Event> &events);
+
+}
+
+#endif /* PHYBER_ENGINE_INPUT_H */
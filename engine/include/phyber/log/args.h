@@ -0,0 +1,130 @@
+#ifndef PHYBER_ENGINE_LOG_ARGS_H
+#define PHYBER_ENGINE_LOG_ARGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// compact, type tagged encoding of printf arguments, so formatting can be
+// done later (on the writer thread or offline) from the format string alone
+
+namespace Phyber {
+namespace Log {
+namespace Args {
+
+enum class Type : uint8_t {
+    INT = 1, // int64
+    UINT,    // uint64
+    DOUBLE,
+    STRING,  // uint32 length then the bytes
+    POINTER  // uint64
+};
+
+// strings longer than this are cut off when encoded
+constexpr uint32_t MAX_STRING = 1024;
+
+template <typename T>
+constexpr Type type_of() {
+    using U = std::remove_cv_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return Type::INT;
+    } else if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *>) {
+        return Type::STRING;
+    } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+        return Type::POINTER;
+    } else if constexpr (std::is_enum_v<U>) {
+        return std::is_signed_v<std::underlying_type_t<U>> ? Type::INT : Type::UINT;
+    } else if constexpr (std::is_integral_v<U>) {
+        return std::is_signed_v<U> ? Type::INT : Type::UINT;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return Type::DOUBLE;
+    } else {
+        static_assert(std::is_arithmetic_v<U>, "Unsupported log argument type");
+        return Type::INT;
+    }
+}
+
+inline uint32_t string_length(const char *str) {
+    if (!str) { return 0; }
+    size_t len = strnlen(str, MAX_STRING);
+    return static_cast<uint32_t>(len);
+}
+
+template <typename T>
+size_t size_of(const T &value) {
+    if constexpr (type_of<T>() == Type::STRING) {
+        return 1 + sizeof(uint32_t) + string_length(value);
+    } else {
+        (void)value;
+        return 1 + 8;
+    }
+}
+
+template <typename T>
+uint8_t *encode_one(uint8_t *out, const T &value) {
+    constexpr Type type = type_of<T>();
+    *out++ = static_cast<uint8_t>(type);
+    if constexpr (type == Type::STRING) {
+        uint32_t len = string_length(value);
+        memcpy(out, &len, sizeof(len));
+        if (len) { memcpy(out + sizeof(len), value, len); }
+        return out + sizeof(len) + len;
+    } else {
+        if constexpr (type == Type::INT) {
+            int64_t v = static_cast<int64_t>(value);
+            memcpy(out, &v, 8);
+        } else if constexpr (type == Type::UINT) {
+            uint64_t v = static_cast<uint64_t>(value);
+            memcpy(out, &v, 8);
+        } else if constexpr (type == Type::DOUBLE) {
+            double v = static_cast<double>(value);
+            memcpy(out, &v, 8);
+        } else {
+            uint64_t v = reinterpret_cast<uintptr_t>(static_cast<const void *>(value));
+            memcpy(out, &v, 8);
+        }
+        return out + 8;
+    }
+}
+
+template <typename... A>
+size_t encoded_size(const A &...args) {
+    return (size_t(0) + ... + size_of(args));
+}
+
+template <typename... A>
+void encode(uint8_t *out, const A &...args) {
+    ((out = encode_one(out, args)), ...);
+    (void)out;
+}
+
+// one decoded argument
+struct Value {
+    Type type;
+    uint64_t bits;   // INT, UINT, DOUBLE and POINTER, as stored
+    const char *str; // STRING, not null terminated
+    uint32_t len;
+
+    int64_t as_int() const;
+    double as_double() const;
+};
+
+// decodes the argument at p and moves past it, false at the end or if the
+// encoding is cut off
+extern bool next(const uint8_t *&p, const uint8_t *end, Value &value);
+
+// writes a number (any type but STRING) as text with std::to_chars, doubles
+// in their shortest round trip form. Needs 32 bytes, returns the end
+extern char *number_to_chars(const Value &value, char *out);
+
+// formats encoded arguments with a printf format string, as if they had
+// been passed to snprintf. Conversions without a matching argument print
+// nothing. Returns the length written, always null terminated
+extern size_t format(const char *format, const uint8_t *args, size_t args_size, char *out, size_t size);
+
+}
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_ARGS_H */
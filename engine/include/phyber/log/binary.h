@@ -0,0 +1,56 @@
+#ifndef PHYBER_ENGINE_LOG_BINARY_H
+#define PHYBER_ENGINE_LOG_BINARY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "phyber/log/sink.h"
+
+// binary log files, written by the async writer when AsyncConfig::binary_path
+// is set. All integers are little endian, entries are packed:
+//
+//   file header: "PHYBLOG\0", uint32 version
+//   SITE:   type, uint32 id, uint8 level, uint32 line, uint16 file length,
+//           uint16 format length, file, format
+//   RECORD: type, uint32 site id, uint64 timestamp, uint32 thread,
+//           uint32 args length, args (see log/args.h)
+//   FIELDS: same as RECORD, the args are key, value pairs of a
+//           PHYBER_LOG_KV record
+//   TEXT:   type, uint8 level, uint32 line, uint64 timestamp, uint32 thread,
+//           uint16 file length, uint32 text length, file, text
+//   FRAME:  type, uint64 frame, uint64 timestamp, uint32 thread, a frame
+//           marker of the flight recorder (log/flight.h)
+//
+// a SITE entry is written once, before the first RECORD that uses it
+
+namespace Phyber {
+namespace Log {
+namespace Binary {
+
+constexpr char MAGIC[8] = {'P', 'H', 'Y', 'B', 'L', 'O', 'G', '\0'};
+constexpr uint32_t VERSION = 1;
+
+// RECORD and FIELDS args bigger than this are never written, the writer
+// drops them as if their queue was full. Far above what fits a producer
+// queue of the default size, decode() treats anything bigger as corrupt
+constexpr uint32_t MAX_ARGS_LENGTH = 1024 * 1024;
+
+enum class Entry : uint8_t {
+    SITE = 1,
+    RECORD,
+    TEXT,
+    FIELDS,
+    FRAME
+};
+
+// writes the records of a binary log to out, formatted the way a sink with
+// that format would get them. Returns the number of records, or -1 if in
+// isn't a binary log, is cut off or is corrupt (records before that point
+// are still written)
+extern long long decode(FILE *in, FILE *out, Format format = Format::TEXT);
+
+}
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_BINARY_H */
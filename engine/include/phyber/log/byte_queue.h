@@ -0,0 +1,136 @@
+#ifndef PHYBER_ENGINE_LOG_BYTE_QUEUE_H
+#define PHYBER_ENGINE_LOG_BYTE_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+#include "phyber/defs/global_defines.h"
+#include "phyber/utils/ring_buffer.h"
+
+namespace Phyber {
+namespace Log {
+
+// single producer, single consumer queue of variable sized messages. Every
+// message is prefixed by its size and stays contiguous: if it doesn't fit
+// before the end of the buffer the rest of the buffer is skipped with a
+// padding entry and the message starts over at the beginning
+class ByteQueue {
+public:
+    static constexpr size_t ALIGN = 8;
+
+private:
+    // size (including this prefix) of the entry, PAD_BIT set on padding
+    struct Prefix {
+        uint32_t size;
+        uint32_t pad;
+    };
+    static constexpr uint32_t PAD_BIT = 0x80000000u;
+
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<uint64_t> _head {0}; // consumer
+    uint64_t _cached_tail = 0;
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<uint64_t> _tail {0}; // producer
+    uint64_t _cached_head = 0;
+    uint64_t _reserved = 0; // position of the prefix of the last reserve()
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) uint8_t *_buffer = nullptr;
+    size_t _capacity = 0;
+    size_t _mask = 0;
+
+    static size_t round_up(size_t v) { return (v + ALIGN - 1) & ~(ALIGN - 1); }
+
+public:
+    explicit ByteQueue(size_t capacity) {
+        _capacity = RingBufferUtils::round_up_pow2(capacity < 256 ? 256 : capacity);
+        _mask = _capacity - 1;
+        _buffer = static_cast<uint8_t *>(::operator new(_capacity, std::align_val_t(PHYBER_ENGINE_CACHE_LINE_SIZE)));
+    }
+    ~ByteQueue() {
+        ::operator delete(_buffer, std::align_val_t(PHYBER_ENGINE_CACHE_LINE_SIZE));
+    }
+
+    ByteQueue(const ByteQueue &) = delete;
+    ByteQueue &operator=(const ByteQueue &) = delete;
+
+    size_t capacity() const { return _capacity; }
+
+    // biggest message that can ever be reserved
+    size_t max_message() const { return _capacity / 2 - sizeof(Prefix); }
+
+    // producer: space for a message of `size` bytes or nullptr if the queue
+    // is full. Nothing is visible to the consumer until commit()
+    void *reserve(size_t size) {
+        if (size > max_message()) { return nullptr; }
+        const size_t needed = round_up(size + sizeof(Prefix));
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+        size_t offset = tail & _mask;
+        size_t to_end = _capacity - offset;
+        size_t total = needed <= to_end ? needed : to_end + needed;
+
+        if (tail + total - _cached_head > _capacity) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail + total - _cached_head > _capacity) {
+                return nullptr;
+            }
+        }
+
+        if (needed > to_end) {
+            Prefix *pad = reinterpret_cast<Prefix *>(_buffer + offset);
+            pad->size = static_cast<uint32_t>(to_end) | PAD_BIT;
+            tail += to_end;
+            offset = 0;
+        }
+        Prefix *prefix = reinterpret_cast<Prefix *>(_buffer + offset);
+        prefix->size = static_cast<uint32_t>(needed);
+        _reserved = tail;
+        return prefix + 1;
+    }
+
+    // producer: publishes the message from the last reserve()
+    void commit() {
+        const Prefix *prefix = reinterpret_cast<const Prefix *>(_buffer + (_reserved & _mask));
+        _tail.store(_reserved + prefix->size, std::memory_order_release);
+    }
+    // same, but only keeps the first `size` bytes of the reservation
+    void commit(size_t size) {
+        Prefix *prefix = reinterpret_cast<Prefix *>(_buffer + (_reserved & _mask));
+        prefix->size = static_cast<uint32_t>(round_up(size + sizeof(Prefix)));
+        _tail.store(_reserved + prefix->size, std::memory_order_release);
+    }
+
+    // consumer: the oldest message and its (padded) size, or nullptr if the
+    // queue is empty. Call pop() once done with it
+    const void *peek(size_t &size) {
+        for (;;) {
+            uint64_t head = _head.load(std::memory_order_relaxed);
+            if (head == _cached_tail) {
+                _cached_tail = _tail.load(std::memory_order_acquire);
+                if (head == _cached_tail) { return nullptr; }
+            }
+            const Prefix *prefix = reinterpret_cast<const Prefix *>(_buffer + (head & _mask));
+            if (prefix->size & PAD_BIT) {
+                _head.store(head + (prefix->size & ~PAD_BIT), std::memory_order_release);
+                continue;
+            }
+            size = prefix->size - sizeof(Prefix);
+            return prefix + 1;
+        }
+    }
+
+    // consumer: releases the message returned by peek()
+    void pop() {
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        const Prefix *prefix = reinterpret_cast<const Prefix *>(_buffer + (head & _mask));
+        _head.store(head + prefix->size, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+};
+
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_BYTE_QUEUE_H */
@@ -0,0 +1,45 @@
+#ifndef PHYBER_ENGINE_LOG_FLIGHT_H
+#define PHYBER_ENGINE_LOG_FLIGHT_H
+
+#include <stdint.h>
+
+#include "phyber/logging.h"
+
+// crash flight recorder: every thread keeps its last records in a fixed ring
+// of its own, raw arguments only, nothing is formatted. Sites below the
+// output level but at or above the recorder level are recorded without
+// being written, so DEBUG messages are there after a crash even when only
+// INFO is printed. The rings are dumped as a binary log (see log/binary.h),
+// read them with phyber_logdecode
+
+// records kept per thread, every record takes 256 bytes
+#ifndef PHYBER_ENGINE_LOG_FLIGHT_RECORDS
+#define PHYBER_ENGINE_LOG_FLIGHT_RECORDS 256
+#endif
+
+namespace Phyber {
+namespace Log {
+
+// starts recording every call at or above level, a second call changes it
+extern void start_flight_recorder(Level level = Level::DEBUG);
+// recorded records are kept for a later dump
+extern void stop_flight_recorder();
+extern bool is_flight_recording();
+
+// marks the start of a frame in the calling thread's ring
+extern void frame_marker(uint64_t frame);
+
+// writes every ring, oldest record first, to a file descriptor. Only uses
+// async-signal-safe calls, so it can run from a signal handler. A record
+// another thread writes during the dump may come out garbled. Returns false
+// if a write failed
+extern bool dump_flight_recorder(int fd);
+
+// dumps the rings to path when the process dies from SIGSEGV, SIGBUS,
+// SIGFPE, SIGILL or SIGABRT, then lets the signal kill the process as usual
+extern void install_crash_handler(const char *path);
+
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_FLIGHT_H */
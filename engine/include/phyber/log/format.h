@@ -0,0 +1,154 @@
+#ifndef PHYBER_ENGINE_LOG_FORMAT_H
+#define PHYBER_ENGINE_LOG_FORMAT_H
+
+// std::format based logging, only available when the standard library has
+// <format>. Format strings are checked at compile time and engine types can
+// be passed directly:
+//   PHYBER_LOGF(INFO, "player at {:.2f}, {} pending", position, event);
+
+#include <version>
+
+#if defined(__cpp_lib_format)
+
+#include <format>
+#include <stddef.h>
+#include <utility>
+
+#include "phyber/event.h"
+#include "phyber/logging.h"
+#include "phyber/math.h"
+
+namespace Phyber {
+namespace Log {
+
+// formats into a stack buffer, longer messages are cut off
+template <typename... A>
+void log_format(const Site &site, std::format_string<A...> format, A &&...args) {
+    char message[PHYBER_ENGINE_LOG_MAX_MESSAGE];
+    auto result = std::format_to_n(message, sizeof(message), format, std::forward<A>(args)...);
+    size_t len = static_cast<size_t>(result.size);
+    if (len > sizeof(message)) { len = sizeof(message); }
+    log_text(site, message, len);
+}
+
+namespace FormatUtils {
+
+// "(a, b, c)" with every component formatted by f
+template <typename T, typename FormatContext>
+auto format_components(const std::formatter<T> &f, const T *values, size_t n, FormatContext &ctx,
+                       char open = '(', char close = ')') {
+    auto out = ctx.out();
+    *out++ = open;
+    for (size_t i = 0; i < n; ++i) {
+        if (i) {
+            *out++ = ',';
+            *out++ = ' ';
+        }
+        ctx.advance_to(out);
+        out = f.format(values[i], ctx);
+    }
+    *out++ = close;
+    return out;
+}
+
+}
+
+}
+}
+
+// the format spec applies to every component, "{:.2f}"
+template <>
+struct std::formatter<Phyber::Vec2> : std::formatter<float> {
+    template <typename FormatContext>
+    auto format(const Phyber::Vec2 &v, FormatContext &ctx) const {
+        const float values[] = {v.x, v.y};
+        return Phyber::Log::FormatUtils::format_components<float>(*this, values, 2, ctx);
+    }
+};
+
+template <>
+struct std::formatter<Phyber::Vec3> : std::formatter<float> {
+    template <typename FormatContext>
+    auto format(const Phyber::Vec3 &v, FormatContext &ctx) const {
+        const float values[] = {v.x, v.y, v.z};
+        return Phyber::Log::FormatUtils::format_components<float>(*this, values, 3, ctx);
+    }
+};
+
+template <>
+struct std::formatter<Phyber::Vec2Int> : std::formatter<int> {
+    template <typename FormatContext>
+    auto format(const Phyber::Vec2Int &v, FormatContext &ctx) const {
+        const int values[] = {v.x, v.y};
+        return Phyber::Log::FormatUtils::format_components<int>(*this, values, 2, ctx);
+    }
+};
+
+// row by row, "[[m11, m12, m13], [m21, m22, m23], [m31, m32, m33]]"
+template <>
+struct std::formatter<Phyber::Mat3x3> : std::formatter<float> {
+    template <typename FormatContext>
+    auto format(const Phyber::Mat3x3 &mat, FormatContext &ctx) const {
+        auto out = ctx.out();
+        *out++ = '[';
+        for (size_t row = 0; row < 3; ++row) {
+            if (row) {
+                *out++ = ',';
+                *out++ = ' ';
+            }
+            ctx.advance_to(out);
+            out = Phyber::Log::FormatUtils::format_components<float>(*this, mat.m + row * 3, 3, ctx, '[', ']');
+        }
+        *out++ = ']';
+        return out;
+    }
+};
+
+template <>
+struct std::formatter<Phyber::Event> {
+    constexpr auto parse(std::format_parse_context &ctx) {
+        return ctx.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(const Phyber::Event &event, FormatContext &ctx) const {
+        switch (event.type) {
+        case Phyber::EventType::KEYBOARD:
+            return std::format_to(ctx.out(), "Keyboard {} - down: {}, repeat: {}",
+                event.keyboard.key.get_key_name(), event.keyboard.down, event.keyboard.repeat);
+        case Phyber::EventType::MOUSE_MOTION:
+            return std::format_to(ctx.out(), "Mouse motion ({}, {}) delta ({}, {}) buttons {:#x}",
+                event.mouse_motion.x, event.mouse_motion.y, event.mouse_motion.dx, event.mouse_motion.dy,
+                event.mouse_motion.button_state);
+        case Phyber::EventType::MOUSE_BUTTON:
+            return std::format_to(ctx.out(), "Mouse button {} ({}, {}) - down: {}, clicks: {}",
+                static_cast<uint32_t>(event.mouse_button.button), event.mouse_button.x, event.mouse_button.y,
+                event.mouse_button.down, event.mouse_button.clicks);
+        case Phyber::EventType::MOUSE_WHEEL:
+            return std::format_to(ctx.out(), "Mouse wheel ({}, {}){} at ({}, {})",
+                event.mouse_wheel.x, event.mouse_wheel.y,
+                event.mouse_wheel.direction == Phyber::MouseWheelEvent::Direction::FLIPPED ? " flipped" : "",
+                event.mouse_wheel.mouse_x, event.mouse_wheel.mouse_y);
+        case Phyber::EventType::QUIT_EVENT:
+            return std::format_to(ctx.out(), "Quit");
+        default:
+            return std::format_to(ctx.out(), "Unsupported event {}", event.type);
+        }
+    }
+};
+
+// level is DEBUG, INFO, ...
+#define PHYBER_LOGF(level, format, ...) \
+    do { \
+        if constexpr (Phyber::Log::compiled_in(Phyber::Log::Level::level)) { \
+            static constinit Phyber::Log::Site phyber_log_site_ { \
+                Phyber::Log::Level::level, __LINE__, __FILE__, format}; \
+            if (phyber_log_site_.enabled()) { \
+                Phyber::Log::log_format(phyber_log_site_, format PHYBER_VA_COMMA(__VA_ARGS__)); \
+            } \
+        } \
+    } while (0)
+
+#endif /* __cpp_lib_format */
+
+#endif /* PHYBER_ENGINE_LOG_FORMAT_H */
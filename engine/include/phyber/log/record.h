@@ -0,0 +1,78 @@
+#ifndef PHYBER_ENGINE_LOG_RECORD_H
+#define PHYBER_ENGINE_LOG_RECORD_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "phyber/logging.h"
+#include "phyber/log/sink.h"
+
+namespace Phyber {
+namespace Log {
+
+enum class RecordKind : uint8_t {
+    TEXT,    // payload is the formatted message, not null terminated
+    DEFERRED, // payload is the encoded arguments for site->format
+    FIELDS    // payload is encoded key, value pairs, site->format is the message
+};
+
+// fixed part of a log record, the payload follows it directly in memory
+struct RecordHeader {
+    RecordKind kind;
+    Level level;
+    uint16_t reserved;
+    uint32_t line;
+    const char *file;
+    uint64_t timestamp; // nanoseconds since the unix epoch
+    uint32_t thread;    // small id, in order of the thread's first log call
+    uint32_t payload_size;
+    const Site *site;   // DEFERRED records only
+
+    const char *payload() const { return reinterpret_cast<const char *>(this + 1); }
+};
+static_assert(sizeof(RecordHeader) % 8 == 0, "payload must start 8 byte aligned");
+
+// id of the calling thread, assigned on first use
+extern uint32_t thread_id();
+extern uint64_t timestamp_now();
+
+// longest output of format_timestamp()
+constexpr size_t TIMESTAMP_MAX = 32;
+// writes the timestamp as set by set_time_format(), not null terminated,
+// and returns the length
+extern size_t format_timestamp(uint64_t timestamp, char *out);
+
+// room for any formatted record, longer ones are cut off
+constexpr size_t RECORD_TEXT_MAX = 2 * PHYBER_ENGINE_LOG_MAX_MESSAGE + 512;
+
+// writes "[LEVEL] file:line (date time) -> message\n" into out and returns
+// the length. Output longer than size is cut off, the newline is kept.
+// DEFERRED records are formatted here
+extern size_t format_text(const RecordHeader &record, char *out, size_t size);
+// one JSON object and a newline. Output that doesn't fit in size drops
+// fields and cuts the message short, it always stays valid JSON
+extern size_t format_json(const RecordHeader &record, char *out, size_t size);
+extern size_t format_record(const RecordHeader &record, char *out, size_t size, Format format);
+
+// queues the record when async mode is on, returns false (without touching
+// args) when it is off
+extern bool async_vlog(Level level, const char *file, unsigned int line, const char *format, va_list args);
+
+// space for a record with args_size bytes of payload in the calling thread's
+// queue. Returns nullptr when async mode is off, or with dropped set when
+// the queue was full. The header is filled in, async_commit() publishes it
+extern uint8_t *async_begin(const Site &site, RecordKind kind, size_t args_size, bool &dropped);
+extern void async_commit(size_t args_size);
+
+// while recording is set, sites below their output level but at or above
+// level are RECORDED, see log/flight.h
+extern void set_recorded_level(bool recording, Level level);
+
+// keeps a formatted message in the calling thread's flight ring
+extern void flight_text(const Site &site, const char *message, size_t len);
+
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_RECORD_H */
@@ -0,0 +1,142 @@
+#ifndef PHYBER_ENGINE_LOG_SINK_H
+#define PHYBER_ENGINE_LOG_SINK_H
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "phyber/utils/datatypes.h"
+
+namespace Phyber {
+namespace Log {
+
+// how records are turned into bytes for a sink
+enum class Format : uint8_t {
+    TEXT, // the human readable "[LEVEL] file:line (time) -> message" lines
+    JSON  // JSON Lines, one object per record
+};
+
+// destination of formatted log output. write() always gets one or more
+// whole records, sinks are called from any thread
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void write(const char *data, size_t size) = 0;
+    virtual Format format() const { return Format::TEXT; }
+    // pushes anything buffered to the OS
+    virtual void flush() {}
+};
+
+// replaces the sink, nullptr goes back to stdout. The sink isn't owned and
+// has to outlive its use, so switch back before destroying it
+extern void set_sink(Sink *sink);
+extern Sink &current_sink();
+
+// every write() is a single write to stdout under a lock, so records from
+// different threads never interleave
+class StdoutSink : public Sink {
+private:
+    std::mutex _mutex;
+    Format _format;
+
+public:
+    StdoutSink(Format format = Format::TEXT) : _format(format) {}
+
+    void write(const char *data, size_t size) override;
+    Format format() const override { return _format; }
+    void flush() override;
+};
+
+struct FileSinkConfig {
+    size_t buffer_size = 256 * 1024; // written out when full or on flush()
+    // rotation, 0 disables it. The current file moves to path.1, path.1 to
+    // path.2 and so on up to max_files
+    uint64_t max_bytes = 0;
+    uint32_t max_seconds = 0;
+    uint32_t max_files = 5;
+    // buffered records are written out by the first write() this long after
+    // the last write out, 0 waits for a full buffer or flush()
+    uint32_t flush_seconds = 1;
+    Format format = Format::TEXT;
+};
+
+// collects records in memory and writes them out with one writev() per
+// flush. Throws std::runtime_error if the file can't be opened
+class FileSink : public Sink {
+private:
+    // records are never split between chunks
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    struct Chunk {
+        char *data;
+        size_t used;
+    };
+
+    std::mutex _mutex;
+    FileSinkConfig _config;
+    char *_path;
+    int _fd = -1;
+    uint64_t _file_bytes = 0; // written to the current file
+    uint64_t _opened_at = 0;  // seconds, steady clock
+    uint64_t _written_at = 0; // last write out, seconds, steady clock
+    DynamicArray<Chunk> _chunks;
+    size_t _buffered = 0;
+
+    void open_file();
+    void try_open_file();
+    void rotate();
+    void prepare_file(size_t incoming);
+    void write_out();
+    void write_direct(const char *data, size_t size);
+
+public:
+    FileSink(const char *path, const FileSinkConfig &config = FileSinkConfig());
+    ~FileSink() override;
+
+    FileSink(const FileSink &) = delete;
+    FileSink &operator=(const FileSink &) = delete;
+
+    void write(const char *data, size_t size) override;
+    void flush() override;
+    Format format() const override { return _config.format; }
+};
+
+// keeps the newest bytes of output in a fixed size memory mapped file, so
+// writes never make a syscall and the log survives a crash of the process.
+// The file starts with a RingFileHeader, the data wraps around after it
+struct RingFileHeader {
+    char magic[8]; // "PHYRING\0"
+    uint64_t capacity;
+    uint64_t written; // total bytes ever written, the data ends at written % capacity
+    uint64_t reserved[5];
+};
+static_assert(sizeof(RingFileHeader) == 64, "RingFileHeader must stay 64 bytes");
+
+class RingFileSink : public Sink {
+private:
+    std::mutex _mutex;
+    void *_base = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    void *_mapping = nullptr;
+#endif
+    RingFileHeader *_header = nullptr;
+
+public:
+    // capacity is the data size, the file is 64 bytes bigger. Throws
+    // std::runtime_error if the file can't be created or mapped
+    RingFileSink(const char *path, size_t capacity);
+    ~RingFileSink() override;
+
+    RingFileSink(const RingFileSink &) = delete;
+    RingFileSink &operator=(const RingFileSink &) = delete;
+
+    void write(const char *data, size_t size) override;
+    // asks the OS to write the mapping back to the file
+    void flush() override;
+};
+
+}
+}
+
+#endif /* PHYBER_ENGINE_LOG_SINK_H */
@@ -1,8 +1,25 @@
 #ifndef PHYBER_ENGINE_LOGGING_H
 #define PHYBER_ENGINE_LOGGING_H
 
+#include <atomic>
+#include <chrono>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "phyber/log/args.h"
+
+// longest message a single log call keeps, longer ones are cut off
+#ifndef PHYBER_ENGINE_LOG_MAX_MESSAGE
+#define PHYBER_ENGINE_LOG_MAX_MESSAGE 1024
+#endif
+
+// PHYBER_LOG_* calls below this level are compiled out together with their
+// arguments. 0 keeps every level, 5 removes every call
+#ifndef PHYBER_ENGINE_LOG_MIN_LEVEL
+#define PHYBER_ENGINE_LOG_MIN_LEVEL 0
+#endif
+
 namespace Phyber {
 namespace Log {
 
@@ -10,8 +27,213 @@ enum class Level : uint8_t {
     DEBUG, INFO, WARNING, ERROR, CRITICAL
 };
 
+// what a producer does when its async queue is full
+enum class OverflowPolicy : uint8_t {
+    DROP,  // discard the record and count it, see dropped_count()
+    BLOCK  // wait for the writer thread to make room, dropped if async mode stops meanwhile
+};
+
+struct AsyncConfig {
+    size_t queue_bytes = 256 * 1024; // per producing thread
+    OverflowPolicy overflow = OverflowPolicy::DROP;
+    unsigned int idle_sleep_us = 1000; // writer poll interval when idle
+    // macro call sites only copy their raw arguments, the writer thread
+    // does the formatting
+    bool defer_formatting = false;
+    // write a binary log here instead of text to stdout, formatting is
+    // always deferred, to phyber_logdecode. See log/binary.h
+    const char *binary_path = nullptr;
+};
+
+// how log lines show their timestamp
+enum class TimeFormat : uint8_t {
+    DATE, // local date and time with microseconds
+    RAW   // nanoseconds since the unix epoch, left for tools to format
+};
+
+// runtime filter verdict of a call site
+enum class SiteState : uint8_t {
+    UNKNOWN, // not registered yet, decided on the first call
+    ENABLED,
+    RECORDED, // below the output level, only kept by the flight recorder
+    DISABLED
+};
+
+// static description of one PHYBER_LOG_* call site
+struct Site {
+    Level level;
+    unsigned int line;
+    const char *file;
+    const char *format;
+    std::atomic<SiteState> state {SiteState::UNKNOWN};
+
+    // a single relaxed load once the site is registered
+    bool enabled();
+};
+
+// runtime levels, messages below them are skipped without evaluating their
+// arguments. The most specific match wins: file, then module, then global.
+// A module is a directory, "2d" matches every file under a 2d/ directory.
+// A file matches its path from the end, "renderer.cpp" or "2d/renderer.cpp"
+extern void set_level(Level level);
+extern void set_module_level(const char *module, Level level);
+extern void set_file_level(const char *file, Level level);
+// removes every module and file level
+extern void clear_levels();
+
+extern void set_time_format(TimeFormat format);
+
+// adds the site to the filter, returns whether it is enabled or recorded
+extern bool register_site(Site &site);
+
+inline bool Site::enabled() {
+    const SiteState s = state.load(std::memory_order_relaxed);
+    return s == SiteState::ENABLED || s == SiteState::RECORDED || (s == SiteState::UNKNOWN && register_site(*this));
+}
+
+// whether calls at this level are compiled in
+constexpr bool compiled_in(Level level) {
+    return level >= static_cast<Level>(PHYBER_ENGINE_LOG_MIN_LEVEL);
+}
+
 extern void printf_impl(Level level, const char *file, unsigned int line, const char *format, ...);
+extern void vprintf_impl(Level level, const char *file, unsigned int line, const char *format, va_list args);
+
+// set while log calls should record raw arguments instead of formatting
+extern std::atomic<bool> deferred_mode;
+// space in the calling thread's queue for a deferred record with
+// args_size bytes of encoded arguments. nullptr and dropped set if it was
+// dropped, nullptr alone if the record has to be logged synchronously
+extern uint8_t *deferred_begin(const Site &site, size_t args_size, bool &dropped);
+extern void deferred_commit(size_t args_size);
 
+// set while the flight recorder runs, see log/flight.h
+extern std::atomic<bool> flight_mode;
+// space in the calling thread's flight ring for args_size bytes of encoded
+// arguments. Records with more than fit are kept as their format followed
+// by "[args truncated]", nullptr is returned and no commit is needed
+extern uint8_t *flight_begin(const Site &site, size_t args_size, bool fields = false);
+extern void flight_commit();
+
+// records the arguments if the flight recorder runs, returns whether the
+// site is only recorded and its output should be skipped
+template <typename... A>
+bool flight_record(const Site &site, bool fields, A... args) {
+    if (!flight_mode.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    const size_t size = Args::encoded_size(args...);
+    if (uint8_t *out = flight_begin(site, size, fields)) {
+        Args::encode(out, args...);
+        flight_commit();
+    }
+    return site.state.load(std::memory_order_relaxed) == SiteState::RECORDED;
+}
+
+// logs an already formatted message for the site, see log/format.h
+extern void log_text(const Site &site, const char *message, size_t len);
+
+// space for a structured record with args_size bytes of encoded fields,
+// nullptr if it was dropped
+extern uint8_t *fields_begin(const Site &site, size_t args_size);
+extern void fields_commit(size_t args_size);
+
+template <typename K, typename V, typename... Rest>
+constexpr bool are_fields() {
+    if constexpr (sizeof...(Rest) > 0) {
+        return Args::type_of<K>() == Args::Type::STRING && are_fields<Rest...>();
+    } else {
+        return Args::type_of<K>() == Args::Type::STRING;
+    }
+}
+
+// site.format is the message, fields are "key", value, "key", value...
+// They are encoded as is, never formatted with printf
+template <typename... A>
+void log_fields(const Site &site, A... fields) {
+    if constexpr (sizeof...(A) > 0) {
+        static_assert(sizeof...(A) % 2 == 0 && are_fields<A...>(), "Fields must be key, value pairs with string keys");
+    }
+    if (flight_record(site, true, fields...)) {
+        return;
+    }
+    const size_t size = Args::encoded_size(fields...);
+    if (uint8_t *out = fields_begin(site, size)) {
+        Args::encode(out, fields...);
+        fields_commit(size);
+    }
+}
+
+// per call site state of the rate limited macros, PHYBER_LOG_EVERY_N etc.
+// Suppressed calls cost an atomic update (and a clock read for every_ms)
+struct RateLimit {
+    std::atomic<uint64_t> calls {0};
+    std::atomic<uint64_t> suppressed {0};
+    std::atomic<int64_t> next_ms {0}; // every_ms: earliest time of the next message
+
+    // the 1st, n+1th, 2n+1th... call. reported is set to the number of
+    // calls suppressed since the last message
+    bool every_n(uint64_t n, unsigned long long &reported) {
+        if (n > 1 && calls.fetch_add(1, std::memory_order_relaxed) % n != 0) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        reported = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // at most one call every ms milliseconds
+    bool every_ms(int64_t ms, unsigned long long &reported) {
+        const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = next_ms.load(std::memory_order_relaxed);
+        if (now < next || !next_ms.compare_exchange_strong(next, now + ms, std::memory_order_relaxed)) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        reported = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // the first n calls, later ones are only a relaxed load
+    bool first_n(uint64_t n) {
+        if (calls.load(std::memory_order_relaxed) >= n) {
+            return false;
+        }
+        return calls.fetch_add(1, std::memory_order_relaxed) < n;
+    }
+};
+
+// writes the message of an enabled site
+template <typename... A>
+void log(const Site &site, A... args) {
+    if (flight_record(site, false, args...)) {
+        return;
+    }
+    if (deferred_mode.load(std::memory_order_relaxed)) {
+        const size_t size = Args::encoded_size(args...);
+        bool dropped;
+        if (uint8_t *out = deferred_begin(site, size, dropped)) {
+            Args::encode(out, args...);
+            deferred_commit(size);
+            return;
+        }
+        if (dropped) { return; }
+    }
+    printf_impl(site.level, site.file, site.line, site.format, args...);
+}
+
+// async mode: log calls format their message into a queue owned by the
+// calling thread and return, a background thread does the output in batches
+extern void start_async(const AsyncConfig &config = AsyncConfig());
+// writes everything still queued and joins the writer thread. Log calls
+// racing with stop_async() may be lost
+extern void stop_async();
+extern bool is_async();
+// blocks until every record logged before the call has been written
+extern void flush();
+// records discarded because of OverflowPolicy::DROP
+extern uint64_t dropped_count();
 
 }
 }
@@ -23,19 +245,78 @@ extern void printf_impl(Level level, const char *file, unsigned int line, const
     #define PHYBER_VA_COMMA(...) , ##__VA_ARGS__
 #endif
 
-#define PHYBER_LOG_DEBUG(format, ...) \
-    Phyber::Log::printf_impl(Phyber::Log::Level::DEBUG, __FILE__, __LINE__, format PHYBER_VA_COMMA(__VA_ARGS__))
+// format must be a string literal, it is kept by address for deferred
+// formatting. Arguments are only evaluated when the site is enabled
+#define PHYBER_LOG_AT(level, format, ...) \
+    do { \
+        if constexpr (Phyber::Log::compiled_in(level)) { \
+            static constinit Phyber::Log::Site phyber_log_site_ {level, __LINE__, __FILE__, format}; \
+            if (phyber_log_site_.enabled()) { \
+                Phyber::Log::log(phyber_log_site_ PHYBER_VA_COMMA(__VA_ARGS__)); \
+            } \
+        } \
+    } while (0)
+
+// rate limited variants, level is DEBUG, INFO, ... Messages after
+// suppressed calls end with "(n suppressed)"
+//   PHYBER_LOG_EVERY_N(DEBUG, 100, "frame %i", frame);
+#define PHYBER_LOG_LIMITED_(level, check, format, ...) \
+    do { \
+        if constexpr (Phyber::Log::compiled_in(level)) { \
+            static constinit Phyber::Log::Site phyber_log_site_ {level, __LINE__, __FILE__, format}; \
+            static constinit Phyber::Log::Site phyber_log_suppressed_site_ { \
+                level, __LINE__, __FILE__, format " (%llu suppressed)"}; \
+            static constinit Phyber::Log::RateLimit phyber_log_limit_ {}; \
+            unsigned long long phyber_log_suppressed_ = 0; \
+            if (phyber_log_site_.enabled() && phyber_log_limit_.check) { \
+                if (phyber_log_suppressed_ && phyber_log_suppressed_site_.enabled()) { \
+                    Phyber::Log::log(phyber_log_suppressed_site_ PHYBER_VA_COMMA(__VA_ARGS__), phyber_log_suppressed_); \
+                } else { \
+                    Phyber::Log::log(phyber_log_site_ PHYBER_VA_COMMA(__VA_ARGS__)); \
+                } \
+            } \
+        } \
+    } while (0)
+
+#define PHYBER_LOG_EVERY_N(level, n, ...) \
+    PHYBER_LOG_LIMITED_(Phyber::Log::Level::level, every_n(n, phyber_log_suppressed_), __VA_ARGS__)
+
+#define PHYBER_LOG_EVERY_MS(level, ms, ...) \
+    PHYBER_LOG_LIMITED_(Phyber::Log::Level::level, every_ms(ms, phyber_log_suppressed_), __VA_ARGS__)
+
+#define PHYBER_LOG_FIRST_N(level, n, ...) \
+    PHYBER_LOG_LIMITED_(Phyber::Log::Level::level, first_n(n), __VA_ARGS__)
+
+#define PHYBER_LOG_ONCE(level, ...) \
+    PHYBER_LOG_FIRST_N(level, 1, __VA_ARGS__)
+
+// structured record, level is DEBUG, INFO, ... Sinks with Format::JSON
+// write the fields as members of the record's object
+//   PHYBER_LOG_KV(INFO, "frame done", "frame", frame, "ms", ms);
+#define PHYBER_LOG_KV(level, message, ...) \
+    do { \
+        if constexpr (Phyber::Log::compiled_in(Phyber::Log::Level::level)) { \
+            static constinit Phyber::Log::Site phyber_log_site_ { \
+                Phyber::Log::Level::level, __LINE__, __FILE__, message}; \
+            if (phyber_log_site_.enabled()) { \
+                Phyber::Log::log_fields(phyber_log_site_ PHYBER_VA_COMMA(__VA_ARGS__)); \
+            } \
+        } \
+    } while (0)
+
+#define PHYBER_LOG_DEBUG(...) \
+    PHYBER_LOG_AT(Phyber::Log::Level::DEBUG, __VA_ARGS__)
 
-#define PHYBER_LOG_INFO(format, ...) \
-    Phyber::Log::printf_impl(Phyber::Log::Level::INFO, __FILE__, __LINE__, format PHYBER_VA_COMMA(__VA_ARGS__))
+#define PHYBER_LOG_INFO(...) \
+    PHYBER_LOG_AT(Phyber::Log::Level::INFO, __VA_ARGS__)
 
-#define PHYBER_LOG_WARNING(format, ...) \
-    Phyber::Log::printf_impl(Phyber::Log::Level::WARNING, __FILE__, __LINE__, format PHYBER_VA_COMMA(__VA_ARGS__))
+#define PHYBER_LOG_WARNING(...) \
+    PHYBER_LOG_AT(Phyber::Log::Level::WARNING, __VA_ARGS__)
 
-#define PHYBER_LOG_ERROR(format, ...) \
-    Phyber::Log::printf_impl(Phyber::Log::Level::ERROR, __FILE__, __LINE__, format PHYBER_VA_COMMA(__VA_ARGS__))
+#define PHYBER_LOG_ERROR(...) \
+    PHYBER_LOG_AT(Phyber::Log::Level::ERROR, __VA_ARGS__)
 
-#define PHYBER_LOG_CRITICAL(format, ...) \
-    Phyber::Log::printf_impl(Phyber::Log::Level::CRITICAL, __FILE__, __LINE__, format PHYBER_VA_COMMA(__VA_ARGS__))
+#define PHYBER_LOG_CRITICAL(...) \
+    PHYBER_LOG_AT(Phyber::Log::Level::CRITICAL, __VA_ARGS__)
 
 #endif /* PHYBER_ENGINE_LOGGING_H */
@@ -0,0 +1,381 @@
+#ifndef PHYBER_ENGINE_BITSET_H
+#define PHYBER_ENGINE_BITSET_H
+
+#include <bit>
+#include <new>
+#include <stdexcept>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Phyber {
+
+namespace BitOps {
+
+typedef uint64_t word_t;
+constexpr size_t WORD_BITS = 64;
+constexpr size_t npos = static_cast<size_t>(-1);
+
+constexpr size_t words_for(size_t bits) {
+    return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+// mask of the valid bits in the last word of a set of `bits` bits
+constexpr word_t tail_mask(size_t bits) {
+    return (bits % WORD_BITS) == 0 ? ~word_t(0) : (word_t(1) << (bits % WORD_BITS)) - 1;
+}
+
+// index of the first word in [begin, end) that is not zero, or end.
+// zero words are skipped several at a time with SIMD when available
+inline size_t first_nonzero_word(const word_t *words, size_t begin, size_t end) {
+#if defined(__AVX2__)
+    for (; begin + 4 <= end; begin += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + begin));
+        if (!_mm256_testz_si256(v, v)) { break; }
+    }
+#elif defined(__SSE4_1__)
+    for (; begin + 2 <= end; begin += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + begin));
+        if (!_mm_testz_si128(v, v)) { break; }
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; begin + 2 <= end; begin += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + begin));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xFFFF) { break; }
+    }
+#endif
+    for (; begin < end; ++begin) {
+        if (words[begin]) { return begin; }
+    }
+    return end;
+}
+
+// index of the first word in [begin, end) that is not all ones, or end
+inline size_t first_nonfull_word(const word_t *words, size_t begin, size_t end) {
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    for (; begin + 4 <= end; begin += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + begin));
+        if (!_mm256_testc_si256(v, ones)) { break; }
+    }
+#elif defined(__SSE4_1__)
+    const __m128i ones = _mm_set1_epi64x(-1);
+    for (; begin + 2 <= end; begin += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + begin));
+        if (!_mm_testc_si128(v, ones)) { break; }
+    }
+#elif defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (; begin + 2 <= end; begin += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + begin));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, ones)) != 0xFFFF) { break; }
+    }
+#endif
+    for (; begin < end; ++begin) {
+        if (~words[begin]) { return begin; }
+    }
+    return end;
+}
+
+inline size_t find_next_set(const word_t *words, size_t bits, size_t pos) {
+    if (pos >= bits) { return npos; }
+    const size_t n_words = words_for(bits);
+    size_t w = pos / WORD_BITS;
+
+    // bits past `bits` are always zero, so the last word needs no masking
+    word_t first = words[w] & (~word_t(0) << (pos % WORD_BITS));
+    if (first) {
+        return w * WORD_BITS + std::countr_zero(first);
+    }
+
+    w = first_nonzero_word(words, w + 1, n_words);
+    if (w == n_words) { return npos; }
+    return w * WORD_BITS + std::countr_zero(words[w]);
+}
+
+inline size_t find_next_clear(const word_t *words, size_t bits, size_t pos) {
+    if (pos >= bits) { return npos; }
+    const size_t n_words = words_for(bits);
+    size_t w = pos / WORD_BITS;
+
+    word_t first = ~words[w] & (~word_t(0) << (pos % WORD_BITS));
+    if (!first) {
+        w = first_nonfull_word(words, w + 1, n_words);
+        if (w == n_words) { return npos; }
+        first = ~words[w];
+    }
+
+    size_t index = w * WORD_BITS + std::countr_zero(first);
+    return index < bits ? index : npos;
+}
+
+inline size_t popcount(const word_t *words, size_t n_words) {
+    size_t count = 0;
+    for (size_t i = 0; i < n_words; ++i) {
+        count += std::popcount(words[i]);
+    }
+    return count;
+}
+
+// the bulk operations are plain loops over whole words, which compilers
+// vectorize on their own
+inline void and_words(word_t *dst, const word_t *src, size_t n_words) {
+    for (size_t i = 0; i < n_words; ++i) { dst[i] &= src[i]; }
+}
+
+inline void or_words(word_t *dst, const word_t *src, size_t n_words) {
+    for (size_t i = 0; i < n_words; ++i) { dst[i] |= src[i]; }
+}
+
+inline void xor_words(word_t *dst, const word_t *src, size_t n_words) {
+    for (size_t i = 0; i < n_words; ++i) { dst[i] ^= src[i]; }
+}
+
+inline void andnot_words(word_t *dst, const word_t *src, size_t n_words) {
+    for (size_t i = 0; i < n_words; ++i) { dst[i] &= ~src[i]; }
+}
+
+}
+
+// common interface for the fixed and dynamic bitsets. Derived classes provide
+// words(), word_count() and size(); bits past size() are kept at zero
+template <typename Derived>
+class BitSetBase {
+private:
+    Derived &self() { return static_cast<Derived &>(*this); }
+    const Derived &self() const { return static_cast<const Derived &>(*this); }
+
+    template <typename Other>
+    void check_same_size(const BitSetBase<Other> &other) const {
+        if (static_cast<const Other &>(other).size() != self().size()) {
+            throw std::invalid_argument("BitSet size mismatch");
+        }
+    }
+
+protected:
+    void clear_tail() {
+        if (self().word_count() > 0) {
+            self().words()[self().word_count() - 1] &= BitOps::tail_mask(self().size());
+        }
+    }
+
+public:
+    static constexpr size_t npos = BitOps::npos;
+
+    // iterates over the indices of the set bits, in increasing order
+    class SetBitIterator {
+        const Derived *_bits = nullptr;
+        size_t _index = npos;
+
+    public:
+        SetBitIterator() {}
+        SetBitIterator(const Derived *bits, size_t index) : _bits(bits), _index(index) {}
+
+        size_t operator*() const { return _index; }
+        SetBitIterator &operator++() {
+            _index = _bits->find_next_set(_index + 1);
+            return *this;
+        }
+        bool operator==(const SetBitIterator &other) const { return _index == other._index; }
+        bool operator!=(const SetBitIterator &other) const { return _index != other._index; }
+    };
+
+    struct SetBitRange {
+        const Derived *bits;
+        SetBitIterator begin() const { return SetBitIterator(bits, bits->find_first_set()); }
+        SetBitIterator end() const { return SetBitIterator(bits, npos); }
+    };
+
+    bool test(size_t i) const {
+        return (self().words()[i / BitOps::WORD_BITS] >> (i % BitOps::WORD_BITS)) & 1;
+    }
+    bool operator[](size_t i) const { return test(i); }
+    void set(size_t i) {
+        self().words()[i / BitOps::WORD_BITS] |= BitOps::word_t(1) << (i % BitOps::WORD_BITS);
+    }
+    void set(size_t i, bool value) {
+        if (value) { set(i); } else { clear(i); }
+    }
+    void clear(size_t i) {
+        self().words()[i / BitOps::WORD_BITS] &= ~(BitOps::word_t(1) << (i % BitOps::WORD_BITS));
+    }
+    void flip(size_t i) {
+        self().words()[i / BitOps::WORD_BITS] ^= BitOps::word_t(1) << (i % BitOps::WORD_BITS);
+    }
+
+    void set_all() {
+        if (self().word_count() > 0) {
+            memset(self().words(), 0xFF, self().word_count() * sizeof(BitOps::word_t));
+            clear_tail();
+        }
+    }
+    void clear_all() {
+        if (self().word_count() > 0) {
+            memset(self().words(), 0, self().word_count() * sizeof(BitOps::word_t));
+        }
+    }
+
+    size_t popcount() const { return BitOps::popcount(self().words(), self().word_count()); }
+    bool any() const { return find_first_set() != npos; }
+    bool none() const { return !any(); }
+    bool all() const { return find_first_clear() == npos; }
+
+    size_t find_first_set() const { return find_next_set(0); }
+    size_t find_next_set(size_t pos) const { return BitOps::find_next_set(self().words(), self().size(), pos); }
+    size_t find_first_clear() const { return find_next_clear(0); }
+    size_t find_next_clear(size_t pos) const { return BitOps::find_next_clear(self().words(), self().size(), pos); }
+
+    SetBitRange set_bits() const { return SetBitRange{&self()}; }
+
+    // calls f(index) for every set bit, cheaper than going through SetBitIterator
+    template <typename F>
+    void for_each_set(F &&f) const {
+        const BitOps::word_t *words = self().words();
+        for (size_t w = 0; w < self().word_count(); ++w) {
+            BitOps::word_t word = words[w];
+            while (word) {
+                f(w * BitOps::WORD_BITS + std::countr_zero(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    template <typename Other>
+    Derived &operator&=(const BitSetBase<Other> &other) {
+        check_same_size(other);
+        BitOps::and_words(self().words(), static_cast<const Other &>(other).words(), self().word_count());
+        return self();
+    }
+    template <typename Other>
+    Derived &operator|=(const BitSetBase<Other> &other) {
+        check_same_size(other);
+        BitOps::or_words(self().words(), static_cast<const Other &>(other).words(), self().word_count());
+        return self();
+    }
+    template <typename Other>
+    Derived &operator^=(const BitSetBase<Other> &other) {
+        check_same_size(other);
+        BitOps::xor_words(self().words(), static_cast<const Other &>(other).words(), self().word_count());
+        return self();
+    }
+    // clears every bit that is set in other
+    template <typename Other>
+    Derived &and_not(const BitSetBase<Other> &other) {
+        check_same_size(other);
+        BitOps::andnot_words(self().words(), static_cast<const Other &>(other).words(), self().word_count());
+        return self();
+    }
+
+    template <typename Other>
+    bool operator==(const BitSetBase<Other> &other) const {
+        const Other &o = static_cast<const Other &>(other);
+        return self().size() == o.size() &&
+            (self().word_count() == 0 || memcmp(self().words(), o.words(), self().word_count() * sizeof(BitOps::word_t)) == 0);
+    }
+};
+
+template <size_t N>
+class FixedBitSet : public BitSetBase<FixedBitSet<N>> {
+private:
+    BitOps::word_t _words[BitOps::words_for(N) > 0 ? BitOps::words_for(N) : 1] = {};
+
+public:
+    FixedBitSet() {}
+
+    constexpr size_t size() const { return N; }
+    constexpr size_t word_count() const { return BitOps::words_for(N); }
+    BitOps::word_t *words() { return _words; }
+    const BitOps::word_t *words() const { return _words; }
+};
+
+class BitSet : public BitSetBase<BitSet> {
+private:
+    BitOps::word_t *_words = nullptr;
+    size_t _size = 0;
+
+public:
+    explicit BitSet(size_t size=0) {
+        resize(size);
+    }
+
+    BitSet(const BitSet &other) {
+        resize(other._size);
+        if (_size > 0) {
+            memcpy(_words, other._words, word_count() * sizeof(BitOps::word_t));
+        }
+    }
+
+    BitSet(BitSet &&other) noexcept : _words(other._words), _size(other._size) {
+        other._words = nullptr;
+        other._size = 0;
+    }
+
+    BitSet &operator=(const BitSet &other) {
+        if (this != &other) {
+            resize(other._size);
+            if (_size > 0) {
+                memcpy(_words, other._words, word_count() * sizeof(BitOps::word_t));
+            }
+        }
+        return *this;
+    }
+
+    BitSet &operator=(BitSet &&other) noexcept {
+        if (this != &other) {
+            free(_words);
+            _words = other._words;
+            _size = other._size;
+            other._words = nullptr;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+    ~BitSet() {
+        free(_words);
+    }
+
+    size_t size() const { return _size; }
+    size_t word_count() const { return BitOps::words_for(_size); }
+    BitOps::word_t *words() { return _words; }
+    const BitOps::word_t *words() const { return _words; }
+
+    // new bits start cleared
+    void resize(size_t new_size) {
+        const size_t old_words = word_count();
+        const size_t new_words = BitOps::words_for(new_size);
+
+        if (new_words != old_words) {
+            if (new_words == 0) {
+                free(_words);
+                _words = nullptr;
+            } else {
+                void *new_ptr = realloc(_words, new_words * sizeof(BitOps::word_t));
+                if (!new_ptr) {
+                    throw std::bad_alloc();
+                }
+                _words = static_cast<BitOps::word_t *>(new_ptr);
+                if (new_words > old_words) {
+                    memset(_words + old_words, 0, (new_words - old_words) * sizeof(BitOps::word_t));
+                }
+            }
+        }
+
+        _size = new_size;
+        clear_tail();
+    }
+};
+
+}
+
+#endif /* PHYBER_ENGINE_BITSET_H */
@@ -3,12 +3,36 @@
 
 // requires c++11 for templates
 
+#include <algorithm>
+#include <bit>
+#include <functional>
 #include <new>
+#include <span>
 #include <stdexcept>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+
+#include "phyber/utils/bitset.h"
+
+#ifndef PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT
+#define PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT 64
+#endif
+
+// number of ids covered by each lazily allocated SparseSet index page
+#ifndef PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE
+#define PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE 4096
+#endif
+
+// FlatHashMap grows when size/capacity would exceed this many 256ths
+#ifndef PHYBER_ENGINE_FLAT_HASH_MAP_MAX_LOAD
+#define PHYBER_ENGINE_FLAT_HASH_MAP_MAX_LOAD 224
+#endif
 
 namespace Phyber {
 
@@ -66,6 +90,8 @@ public:
 
     T *begin() { return _array; }
     T *end() { return _array + _size; }
+    const T *begin() const { return _array; }
+    const T *end() const { return _array + _size; }
     const T &operator[](size_t index) const {
         return _array[index];
     }
@@ -89,6 +115,16 @@ public:
     reserve(size_t new_capacity) {
         if (new_capacity == _capacity) { return; }
 
+        // realloc(ptr, 0) may free ptr and return NULL, which would look
+        // like a failed allocation
+        if (new_capacity == 0) {
+            free(_array);
+            _array = nullptr;
+            _capacity = 0;
+            _size = 0;
+            return;
+        }
+
         // we want a new_ptr because if the allocation fails, we lose track
         // of the pointer to the existing allocated memory, and it will cause
         // a memory leak. By first checking if the allocation is successful, we
@@ -108,6 +144,13 @@ public:
     reserve(size_t new_capacity) {
         if (new_capacity == _capacity) { return; }
 
+        // destroy objects that don't fit in the new capacity
+        for (size_t i = new_capacity; i < _size; ++i) {
+            _array[i].~T();
+        }
+        if (_size > new_capacity)
+            _size = new_capacity;
+
         T* new_array = static_cast<T*>(::operator new(sizeof(T) * new_capacity, std::align_val_t(alignof(T))));
 
         // Move existing objects (need to construct new objects at destination because non exist beforehand)
@@ -116,7 +159,7 @@ public:
             _array[i].~T();
         }
 
-        ::operator delete(_array);
+        ::operator delete(_array, std::align_val_t(alignof(T)));
         _array = new_array;
         _capacity = new_capacity;
     }
@@ -279,6 +322,1035 @@ public:
 #undef ENABLE_TRIVIALLY_SIMPLE
 #undef ENABLE_NON_TRIVIALLY_SIMPLE
 
+// structure-of-arrays container: every field lives in its own contiguous
+// column, aligned to PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT so loops that only
+// read a few fields (e.g. positions and velocities) don't pull the rest
+// through the cache, and columns can be handed directly to SIMD kernels
+template <typename... Fields>
+class SoAArray {
+    static_assert(sizeof...(Fields) > 0, "SoAArray needs at least one field");
+    static_assert((std::is_default_constructible<Fields>::value && ...),
+                  "Fields must be default constructible");
+    static_assert(((std::is_move_constructible<Fields>::value || std::is_trivially_copyable<Fields>::value) && ...),
+                  "Fields must be move constructible or trivially copyable");
+    static_assert((PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT & (PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT - 1)) == 0,
+                  "PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT must be a power of two");
+
+public:
+    template <size_t I>
+    using field_t = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    using reference = std::tuple<Fields &...>;
+    using const_reference = std::tuple<const Fields &...>;
+
+private:
+    using indices = std::index_sequence_for<Fields...>;
+
+    std::tuple<Fields *...> _columns {};
+    size_t _size = 0;
+    size_t _capacity = 0;
+
+    template <typename T>
+    static constexpr std::align_val_t column_alignment() {
+        return std::align_val_t(alignof(T) > PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT
+            ? alignof(T) : PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT);
+    }
+
+    template <typename T>
+    static constexpr bool is_trivially_simple() {
+        return std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value;
+    }
+
+    template <typename T>
+    static T *allocate_column(size_t capacity) {
+        if (capacity == 0) { return nullptr; }
+        return static_cast<T *>(::operator new(sizeof(T) * capacity, column_alignment<T>()));
+    }
+
+    template <typename T>
+    static void free_column(T *column) {
+        if (column) {
+            ::operator delete(column, column_alignment<T>());
+        }
+    }
+
+    template <typename T>
+    static void destroy_range(T *column, size_t from, size_t to) {
+        if constexpr (!is_trivially_simple<T>()) {
+            for (size_t i = from; i < to; ++i) {
+                column[i].~T();
+            }
+        }
+    }
+
+    template <typename T>
+    static void relocate(T *dst, T *src, size_t n) {
+        if constexpr (is_trivially_simple<T>()) {
+            if (n > 0) {
+                memcpy(dst, src, n * sizeof(T));
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                new (dst + i) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    // moves element `from` of a column onto the (live) slot `to` and destroys `from`
+    template <typename T>
+    static void move_slot(T *column, size_t to, size_t from) {
+        if constexpr (is_trivially_simple<T>()) {
+            column[to] = column[from];
+        } else {
+            column[to].~T();
+            new (column + to) T(std::move(column[from]));
+            column[from].~T();
+        }
+    }
+
+    template <typename T>
+    static void shift_left(T *column, size_t pos, size_t size) {
+        if constexpr (is_trivially_simple<T>()) {
+            // can't use memcpy here because source and destination overlap
+            memmove(column + pos, column + pos + 1, (size - pos - 1) * sizeof(T));
+        } else {
+            column[pos].~T();
+            for (size_t i = pos; i < size - 1; ++i) {
+                new (column + i) T(std::move(column[i + 1]));
+                column[i + 1].~T();
+            }
+        }
+    }
+
+    template <size_t... Is>
+    void reallocate(size_t new_capacity, std::index_sequence<Is...>) {
+        std::tuple<Fields *...> new_columns {};
+
+        // allocate every column before touching the old ones, so a failed
+        // allocation leaves the container untouched
+        try {
+            ((std::get<Is>(new_columns) = allocate_column<Fields>(new_capacity)), ...);
+        } catch (...) {
+            (free_column(std::get<Is>(new_columns)), ...);
+            throw;
+        }
+
+        (relocate(std::get<Is>(new_columns), std::get<Is>(_columns), _size), ...);
+        (free_column(std::get<Is>(_columns)), ...);
+
+        _columns = new_columns;
+        _capacity = new_capacity;
+    }
+
+    void grow() {
+        reserve(_capacity > 1 ? (_capacity * 3) / 2 : 2);
+    }
+
+    template <size_t... Is, typename... Args>
+    void construct_back(std::index_sequence<Is...>, Args &&...values) {
+        (new (std::get<Is>(_columns) + _size) Fields(std::forward<Args>(values)), ...);
+    }
+
+    template <size_t... Is>
+    void destroy_all(std::index_sequence<Is...>) {
+        (destroy_range(std::get<Is>(_columns), 0, _size), ...);
+    }
+
+    template <size_t... Is>
+    reference make_reference(size_t index, std::index_sequence<Is...>) {
+        return reference(std::get<Is>(_columns)[index]...);
+    }
+
+    template <size_t... Is>
+    const_reference make_reference(size_t index, std::index_sequence<Is...>) const {
+        return const_reference(std::get<Is>(_columns)[index]...);
+    }
+
+public:
+    // zip iterator over all columns; dereferencing yields a tuple of
+    // references so structured bindings work: `for (auto [pos, vel] : soa)`
+    template <bool Const>
+    class Iterator {
+        using owner_t = std::conditional_t<Const, const SoAArray, SoAArray>;
+        owner_t *_owner = nullptr;
+        size_t _index = 0;
+
+    public:
+        Iterator() {}
+        Iterator(owner_t *owner, size_t index) : _owner(owner), _index(index) {}
+
+        std::conditional_t<Const, const_reference, reference> operator*() const {
+            return (*_owner)[_index];
+        }
+        size_t index() const { return _index; }
+
+        Iterator &operator++() { ++_index; return *this; }
+        Iterator operator++(int) { Iterator tmp = *this; ++_index; return tmp; }
+        Iterator &operator--() { --_index; return *this; }
+        Iterator operator--(int) { Iterator tmp = *this; --_index; return tmp; }
+
+        bool operator==(const Iterator &other) const { return _index == other._index && _owner == other._owner; }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    explicit SoAArray(size_t capacity=0) {
+        reserve(capacity);
+    }
+
+    SoAArray(const SoAArray &) = delete;
+    SoAArray &operator=(const SoAArray &) = delete;
+
+    ~SoAArray() {
+        clear();
+        std::apply([](auto *...columns) { (free_column(columns), ...); }, _columns);
+    }
+
+    size_t capacity() const { return _capacity; }
+    size_t size() const { return _size; }
+
+    // raw column access, valid until the next reallocation
+    template <size_t I>
+    field_t<I> *data() { return std::get<I>(_columns); }
+    template <size_t I>
+    const field_t<I> *data() const { return std::get<I>(_columns); }
+
+    template <size_t I>
+    std::span<field_t<I>> column() { return std::span<field_t<I>>(std::get<I>(_columns), _size); }
+    template <size_t I>
+    std::span<const field_t<I>> column() const { return std::span<const field_t<I>>(std::get<I>(_columns), _size); }
+
+    template <size_t I>
+    field_t<I> &get(size_t index) { return std::get<I>(_columns)[index]; }
+    template <size_t I>
+    const field_t<I> &get(size_t index) const { return std::get<I>(_columns)[index]; }
+
+    reference operator[](size_t index) { return make_reference(index, indices{}); }
+    const_reference operator[](size_t index) const { return make_reference(index, indices{}); }
+    reference at(size_t index) {
+        if (index >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        return make_reference(index, indices{});
+    }
+    const_reference at(size_t index) const {
+        if (index >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        return make_reference(index, indices{});
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, _size); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _size); }
+
+    void reserve(size_t new_capacity) {
+        if (new_capacity < _size) { new_capacity = _size; }
+        if (new_capacity == _capacity) { return; }
+        reallocate(new_capacity, indices{});
+    }
+
+    void resize(size_t new_size) {
+        if (new_size > _capacity) {
+            reserve(new_size);
+        }
+        while (_size < new_size) {
+            construct_back(indices{}, Fields()...);
+            ++_size;
+        }
+        if (new_size < _size) {
+            std::apply([&](auto *...columns) { (destroy_range(columns, new_size, _size), ...); }, _columns);
+            _size = new_size;
+        }
+    }
+
+    void shrink_to_fit() {
+        reserve(_size);
+    }
+
+    void clear() {
+        destroy_all(indices{});
+        _size = 0;
+    }
+
+    // one value per field, in declaration order
+    template <typename... Args>
+    void push_back(Args &&...values) {
+        static_assert(sizeof...(Args) == sizeof...(Fields), "push_back needs one value per field");
+        if (_size == _capacity) {
+            grow();
+        }
+        construct_back(indices{}, std::forward<Args>(values)...);
+        ++_size;
+    }
+
+    void pop_back() {
+        if (_size > 0) {
+            std::apply([&](auto *...columns) { (destroy_range(columns, _size - 1, _size), ...); }, _columns);
+            --_size;
+        }
+    }
+
+    // order preserving, O(n) per column
+    void erase(size_t pos) {
+        if (pos >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        std::apply([&](auto *...columns) { (shift_left(columns, pos, _size), ...); }, _columns);
+        --_size;
+    }
+
+    // O(1), moves the last element into pos
+    void swap_remove(size_t pos) {
+        if (pos >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        if (pos == _size - 1) {
+            pop_back();
+            return;
+        }
+        std::apply([&](auto *...columns) { (move_slot(columns, pos, _size - 1), ...); }, _columns);
+        --_size;
+    }
+
+    void swap(size_t a, size_t b) {
+        if (a >= _size || b >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        std::apply([&](auto *...columns) { (std::swap(columns[a], columns[b]), ...); }, _columns);
+    }
+};
+
+
+// map from integer ids to values with O(1) insert/erase/lookup and values
+// packed contiguously for iteration. The id -> dense index table is split in
+// pages of PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE entries that are only allocated
+// when an id in their range is used. Erase moves the last value into the
+// hole, so dense order is not preserved unless sort() is called again
+template <typename T>
+class SparseSet {
+    static_assert((PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE & (PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE - 1)) == 0,
+                  "PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE must be a power of two");
+
+public:
+    typedef uint32_t id_t;
+    static constexpr id_t INVALID = static_cast<id_t>(-1);
+
+private:
+    static constexpr size_t PAGE_SIZE = PHYBER_ENGINE_SPARSE_SET_PAGE_SIZE;
+
+    DynamicArray<id_t *> _pages;
+    DynamicArray<id_t> _dense;
+    DynamicArray<T> _values;
+
+    id_t dense_index(id_t id) const {
+        size_t page = id / PAGE_SIZE;
+        if (page >= _pages.size() || !_pages[page]) {
+            return INVALID;
+        }
+        return _pages[page][id % PAGE_SIZE];
+    }
+
+    id_t &sparse_slot(id_t id) {
+        size_t page = id / PAGE_SIZE;
+        if (page >= _pages.size()) {
+            _pages.resize(page + 1); // new entries are zeroed, i.e. nullptr
+        }
+        if (!_pages[page]) {
+            id_t *new_page = static_cast<id_t *>(malloc(PAGE_SIZE * sizeof(id_t)));
+            if (!new_page) {
+                throw std::bad_alloc();
+            }
+            memset(new_page, 0xFF, PAGE_SIZE * sizeof(id_t)); // INVALID
+            _pages[page] = new_page;
+        }
+        return _pages[page][id % PAGE_SIZE];
+    }
+
+public:
+    SparseSet() {}
+
+    SparseSet(const SparseSet &) = delete;
+    SparseSet &operator=(const SparseSet &) = delete;
+
+    ~SparseSet() {
+        for (id_t *page : _pages) {
+            free(page);
+        }
+    }
+
+    size_t size() const { return _values.size(); }
+
+    bool contains(id_t id) const {
+        return id != INVALID && dense_index(id) != INVALID;
+    }
+
+    // nullptr if id is not in the set
+    T *find(id_t id) {
+        id_t i = dense_index(id);
+        return i == INVALID ? nullptr : &_values[i];
+    }
+    const T *find(id_t id) const {
+        id_t i = dense_index(id);
+        return i == INVALID ? nullptr : &_values[i];
+    }
+
+    T &at(id_t id) {
+        T *v = find(id);
+        if (!v) {
+            throw std::out_of_range("Id not in set");
+        }
+        return *v;
+    }
+    const T &at(id_t id) const {
+        const T *v = find(id);
+        if (!v) {
+            throw std::out_of_range("Id not in set");
+        }
+        return *v;
+    }
+
+    // inserts, or overwrites the value if id is already present. INVALID
+    // marks empty index entries and can't be used as an id
+    T &insert(id_t id, const T &value) {
+        if (id == INVALID) {
+            throw std::invalid_argument("SparseSet id can't be INVALID");
+        }
+        T *existing = find(id);
+        if (existing) {
+            *existing = value;
+            return *existing;
+        }
+        sparse_slot(id) = static_cast<id_t>(_values.size());
+        _dense.push_back(id);
+        _values.push_back(value);
+        return _values[_values.size() - 1];
+    }
+    T &insert(id_t id, T &&value) {
+        if (id == INVALID) {
+            throw std::invalid_argument("SparseSet id can't be INVALID");
+        }
+        T *existing = find(id);
+        if (existing) {
+            *existing = std::move(value);
+            return *existing;
+        }
+        sparse_slot(id) = static_cast<id_t>(_values.size());
+        _dense.push_back(id);
+        _values.push_back(std::move(value));
+        return _values[_values.size() - 1];
+    }
+
+    bool erase(id_t id) {
+        id_t i = dense_index(id);
+        if (i == INVALID) {
+            return false;
+        }
+
+        const id_t last = static_cast<id_t>(_values.size() - 1);
+        if (i != last) {
+            _values[i] = std::move(_values[last]);
+            _dense[i] = _dense[last];
+            sparse_slot(_dense[i]) = i;
+        }
+        _values.pop_back();
+        _dense.pop_back();
+        sparse_slot(id) = INVALID;
+        return true;
+    }
+
+    // keeps the index pages allocated
+    void clear() {
+        for (id_t id : _dense) {
+            sparse_slot(id) = INVALID;
+        }
+        _dense.clear();
+        _values.clear();
+    }
+
+    // dense storage, values()[i] belongs to ids()[i]
+    T *values() { return _values.begin(); }
+    const T *values() const { return _values.begin(); }
+    const id_t *ids() const { return _dense.begin(); }
+
+    T *begin() { return _values.begin(); }
+    T *end() { return _values.end(); }
+    const T *begin() const { return _values.begin(); }
+    const T *end() const { return _values.end(); }
+
+    // stable sort of the dense arrays by value, e.g. to iterate in draw order
+    template <typename Compare>
+    void sort(Compare less) {
+        const size_t n = _values.size();
+        if (n < 2) { return; }
+
+        DynamicArray<id_t> order;
+        order.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = static_cast<id_t>(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](id_t a, id_t b) {
+            return less(_values[a], _values[b]);
+        });
+
+        // apply the permutation in place, one cycle at a time.
+        // order[i] is the old index of the value that goes to i
+        for (size_t i = 0; i < n; ++i) {
+            if (order[i] == i) { continue; }
+            T tmp = std::move(_values[i]);
+            id_t tmp_id = _dense[i];
+            size_t j = i;
+            for (;;) {
+                size_t k = order[j];
+                order[j] = static_cast<id_t>(j);
+                if (k == i) {
+                    _values[j] = std::move(tmp);
+                    _dense[j] = tmp_id;
+                    break;
+                }
+                _values[j] = std::move(_values[k]);
+                _dense[j] = _dense[k];
+                j = k;
+            }
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            sparse_slot(_dense[i]) = static_cast<id_t>(i);
+        }
+    }
+};
+
+// container that never relocates its elements: storage is a list of
+// fixed-size chunks and erased slots are recycled through an intrusive free
+// list, so pointers returned by insert() stay valid until that element is
+// erased. Iteration walks each chunk's occupancy bitset in address order
+template <typename T, size_t ChunkSize = 64>
+class BlockArray {
+    static_assert(ChunkSize > 0, "ChunkSize must be positive");
+
+private:
+    struct Chunk;
+    union Slot;
+
+    // a free slot links to the next one and remembers its chunk, so
+    // construct() doesn't have to search for it
+    struct FreeLink {
+        Slot *next;
+        Chunk *chunk;
+    };
+
+    union Slot {
+        FreeLink free;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+        const T *value() const { return std::launder(reinterpret_cast<const T *>(storage)); }
+    };
+
+    struct Chunk {
+        Slot slots[ChunkSize];
+        FixedBitSet<ChunkSize> alive;
+    };
+
+    DynamicArray<Chunk *> _chunks; // sorted by address, for erase()
+    Slot *_free = nullptr;
+    size_t _size = 0;
+
+    void add_chunk() {
+        Chunk *chunk = new Chunk();
+
+        size_t pos = std::upper_bound(_chunks.begin(), _chunks.end(), chunk, std::less<Chunk *>()) - _chunks.begin();
+        _chunks.insert(pos, chunk);
+
+        push_free_slots(chunk);
+    }
+
+    // push in reverse so the lowest slot is handed out first
+    void push_free_slots(Chunk *chunk) {
+        for (size_t i = ChunkSize; i > 0; --i) {
+            chunk->slots[i - 1].free = {_free, chunk};
+            _free = chunk->slots + (i - 1);
+        }
+    }
+
+    // chunk and slot index holding ptr, or nullptr if ptr is not ours
+    Chunk *locate(const T *ptr, size_t &index) const {
+        const Slot *slot = reinterpret_cast<const Slot *>(ptr);
+        Chunk *const *it = std::upper_bound(_chunks.begin(), _chunks.end(), slot,
+            [](const Slot *s, const Chunk *c) { return std::less<const Slot *>()(s, c->slots); });
+        if (it == _chunks.begin()) {
+            return nullptr;
+        }
+        Chunk *chunk = *(it - 1);
+        if (std::less<const Slot *>()(slot, chunk->slots) || !std::less<const Slot *>()(slot, chunk->slots + ChunkSize)) {
+            return nullptr;
+        }
+        index = static_cast<size_t>(slot - chunk->slots);
+        return chunk;
+    }
+
+    template <typename... Args>
+    T *construct(Args &&...args) {
+        if (!_free) {
+            add_chunk();
+        }
+        Slot *slot = _free;
+
+        // the link lives in the slot's storage, read it before constructing
+        const FreeLink link = slot->free;
+        new (slot->storage) T(std::forward<Args>(args)...);
+        _free = link.next;
+        link.chunk->alive.set(static_cast<size_t>(slot - link.chunk->slots));
+        ++_size;
+        return slot->value();
+    }
+
+public:
+    template <bool Const>
+    class Iterator {
+        using owner_t = std::conditional_t<Const, const BlockArray, BlockArray>;
+        using value_t = std::conditional_t<Const, const T, T>;
+        owner_t *_owner = nullptr;
+        size_t _chunk = 0;
+        size_t _slot = 0;
+
+        // moves to the first live slot at or after the current position
+        void settle() {
+            while (_chunk < _owner->_chunks.size()) {
+                size_t next = _owner->_chunks[_chunk]->alive.find_next_set(_slot);
+                if (next != BitOps::npos) {
+                    _slot = next;
+                    return;
+                }
+                ++_chunk;
+                _slot = 0;
+            }
+            _slot = 0;
+        }
+
+    public:
+        Iterator() {}
+        Iterator(owner_t *owner, size_t chunk) : _owner(owner), _chunk(chunk) { settle(); }
+
+        value_t &operator*() const { return *_owner->_chunks[_chunk]->slots[_slot].value(); }
+        value_t *operator->() const { return _owner->_chunks[_chunk]->slots[_slot].value(); }
+
+        Iterator &operator++() { ++_slot; settle(); return *this; }
+        Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+        bool operator==(const Iterator &other) const { return _chunk == other._chunk && _slot == other._slot; }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    BlockArray() {}
+
+    BlockArray(const BlockArray &) = delete;
+    BlockArray &operator=(const BlockArray &) = delete;
+
+    ~BlockArray() {
+        clear();
+        for (Chunk *chunk : _chunks) {
+            delete chunk;
+        }
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _chunks.size() * ChunkSize; }
+    size_t chunk_count() const { return _chunks.size(); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, _chunks.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _chunks.size()); }
+
+    // allocates chunks until n elements fit without further allocation
+    void reserve(size_t n) {
+        while (capacity() < n) {
+            add_chunk();
+        }
+    }
+
+    template <typename... Args>
+    T *emplace(Args &&...args) { return construct(std::forward<Args>(args)...); }
+    T *insert(const T &v) { return construct(v); }
+    T *insert(T &&v) { return construct(std::move(v)); }
+
+    bool contains(const T *ptr) const {
+        size_t index = 0;
+        Chunk *chunk = locate(ptr, index);
+        return chunk && chunk->alive.test(index);
+    }
+
+    void erase(T *ptr) {
+        size_t index = 0;
+        Chunk *chunk = locate(ptr, index);
+        if (!chunk || !chunk->alive.test(index)) {
+            throw std::invalid_argument("Pointer is not a live BlockArray element");
+        }
+
+        ptr->~T();
+        chunk->alive.clear(index);
+        Slot *slot = chunk->slots + index;
+        slot->free = {_free, chunk};
+        _free = slot;
+        --_size;
+    }
+
+    // destroys every element but keeps the chunks for reuse
+    void clear() {
+        _free = nullptr;
+        for (size_t c = _chunks.size(); c > 0; --c) {
+            Chunk *chunk = _chunks[c - 1];
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                chunk->alive.for_each_set([&](size_t i) { chunk->slots[i].value()->~T(); });
+            }
+            chunk->alive.clear_all();
+            push_free_slots(chunk);
+        }
+        _size = 0;
+    }
+
+    // calls f(T &) for every element, chunk by chunk
+    template <typename F>
+    void for_each(F &&f) {
+        for (Chunk *chunk : _chunks) {
+            chunk->alive.for_each_set([&](size_t i) { f(*chunk->slots[i].value()); });
+        }
+    }
+};
+
+// default hash for FlatHashMap. Same as std::hash, except strings hash
+// through std::string_view so they can be looked up with a const char * or a
+// string_view without building a std::string
+template <typename K>
+struct Hash : std::hash<K> {};
+
+template <>
+struct Hash<std::string> {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// open addressing hash map with Robin Hood probing. Entries are stored inline
+// in a single slot array, with a parallel byte array holding each slot's probe
+// distance (0 means empty). Erase shifts the following entries back, so there
+// are no tombstones and lookups never get slower after many erases.
+// Pointers and iterators are invalidated by any insertion or erase
+template <typename K, typename V, typename HashT = Hash<K>, typename KeyEqual = std::equal_to<>>
+class FlatHashMap {
+public:
+    using value_type = std::pair<K, V>;
+
+private:
+    // distances are stored in a byte, grow the table before they overflow
+    static constexpr uint8_t MAX_DIST = 255;
+
+    value_type *_slots = nullptr;
+    uint8_t *_dist = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0; // number of slots, zero or a power of two
+    size_t _shift = 64;
+    HashT _hash;
+    KeyEqual _equal;
+
+    template <typename Q>
+    static constexpr bool is_lookup_key() {
+        return std::is_convertible<const Q &, const K &>::value
+            || (requires { typename HashT::is_transparent; } && requires { typename KeyEqual::is_transparent; });
+    }
+
+    // fibonacci hashing spreads weak hashes (like the identity std::hash for
+    // integers) over the whole table
+    template <typename Q>
+    size_t home_slot(const Q &key) const {
+        return static_cast<size_t>((static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull) >> _shift);
+    }
+
+    size_t max_load() const {
+        return (_capacity * PHYBER_ENGINE_FLAT_HASH_MAP_MAX_LOAD) / 256;
+    }
+
+    template <typename Q>
+    size_t find_index(const Q &key) const {
+        if (_size == 0) { return _capacity; }
+        const size_t mask = _capacity - 1;
+        size_t pos = home_slot(key);
+        // an entry further from its home than us would have been displaced
+        // by our key if it were present, so the probe can stop there
+        for (uint8_t dist = 1; _dist[pos] >= dist; ++dist) {
+            if (_equal(_slots[pos].first, key)) {
+                return pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return _capacity;
+    }
+
+    // places a key known not to be present. Returns the slot, or _capacity if
+    // a probe distance would overflow and the table has to grow first
+    template <typename KK, typename... Args>
+    size_t insert_unique(KK &&key, Args &&...args) {
+        const size_t mask = _capacity - 1;
+        size_t pos = home_slot(key);
+        uint8_t dist = 1;
+        while (_dist[pos] >= dist) {
+            if (dist == MAX_DIST - 1) { return _capacity; }
+            ++dist;
+            pos = (pos + 1) & mask;
+        }
+
+        // every entry from pos to the next empty slot moves one slot forward,
+        // which keeps the table ordered by distance
+        size_t empty = pos;
+        while (_dist[empty] != 0) {
+            if (_dist[empty] == MAX_DIST - 1) { return _capacity; }
+            empty = (empty + 1) & mask;
+        }
+        while (empty != pos) {
+            size_t prev = (empty - 1) & mask;
+            new (_slots + empty) value_type(std::move(_slots[prev]));
+            _slots[prev].~value_type();
+            _dist[empty] = _dist[prev] + 1;
+            empty = prev;
+        }
+
+        new (_slots + pos) value_type(std::piecewise_construct,
+            std::forward_as_tuple(std::forward<KK>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        _dist[pos] = dist;
+        return pos;
+    }
+
+    void rehash(size_t new_capacity) {
+        value_type *old_slots = _slots;
+        uint8_t *old_dist = _dist;
+        const size_t old_capacity = _capacity;
+
+        uint8_t *new_dist = static_cast<uint8_t *>(calloc(new_capacity, 1));
+        if (!new_dist) {
+            throw std::bad_alloc();
+        }
+        value_type *new_slots;
+        try {
+            new_slots = static_cast<value_type *>(::operator new(sizeof(value_type) * new_capacity, std::align_val_t(alignof(value_type))));
+        } catch (...) {
+            free(new_dist);
+            throw;
+        }
+
+        _slots = new_slots;
+        _dist = new_dist;
+        _capacity = new_capacity;
+        _shift = 64 - std::countr_zero(static_cast<uint64_t>(new_capacity));
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_dist[i] == 0) { continue; }
+            while (insert_unique(std::move(old_slots[i].first), std::move(old_slots[i].second)) == _capacity) {
+                // pathological clustering, grow the partially filled table.
+                // insert_unique doesn't touch the entry when it fails
+                rehash(_capacity * 2);
+            }
+            old_slots[i].~value_type();
+        }
+
+        if (old_slots) {
+            ::operator delete(old_slots, std::align_val_t(alignof(value_type)));
+        }
+        free(old_dist);
+    }
+
+    void grow() {
+        rehash(_capacity > 0 ? _capacity * 2 : 8);
+    }
+
+    void destroy_all() {
+        if constexpr (!std::is_trivially_destructible<value_type>::value) {
+            for (size_t i = 0; i < _capacity; ++i) {
+                if (_dist[i] != 0) { _slots[i].~value_type(); }
+            }
+        }
+    }
+
+public:
+    template <bool Const>
+    class Iterator {
+        using owner_t = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+        using value_t = std::conditional_t<Const, const value_type, value_type>;
+        owner_t *_owner = nullptr;
+        size_t _index = 0;
+
+        void skip_empty() {
+            while (_index < _owner->_capacity && _owner->_dist[_index] == 0) { ++_index; }
+        }
+
+    public:
+        Iterator() {}
+        Iterator(owner_t *owner, size_t index) : _owner(owner), _index(index) { skip_empty(); }
+        operator Iterator<true>() const { return Iterator<true>(_owner, _index); }
+
+        value_t &operator*() const { return _owner->_slots[_index]; }
+        value_t *operator->() const { return _owner->_slots + _index; }
+
+        Iterator &operator++() { ++_index; skip_empty(); return *this; }
+        Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+        bool operator==(const Iterator &other) const { return _index == other._index; }
+        bool operator!=(const Iterator &other) const { return _index != other._index; }
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    explicit FlatHashMap(size_t capacity=0) {
+        reserve(capacity);
+    }
+
+    FlatHashMap(const FlatHashMap &) = delete;
+    FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+    FlatHashMap(FlatHashMap &&other) noexcept
+        : _slots(other._slots), _dist(other._dist), _size(other._size),
+          _capacity(other._capacity), _shift(other._shift) {
+        other._slots = nullptr;
+        other._dist = nullptr;
+        other._size = 0;
+        other._capacity = 0;
+        other._shift = 64;
+    }
+
+    ~FlatHashMap() {
+        destroy_all();
+        if (_slots) {
+            ::operator delete(_slots, std::align_val_t(alignof(value_type)));
+        }
+        free(_dist);
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    float load_factor() const { return _capacity ? float(_size) / float(_capacity) : 0.0f; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, _capacity); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _capacity); }
+
+    // makes room for n entries without rehashing
+    void reserve(size_t n) {
+        if (n == 0) { return; }
+        size_t new_capacity = 8;
+        while ((new_capacity * PHYBER_ENGINE_FLAT_HASH_MAP_MAX_LOAD) / 256 < n) { new_capacity *= 2; }
+        if (new_capacity > _capacity) {
+            rehash(new_capacity);
+        }
+    }
+
+    void clear() {
+        destroy_all();
+        if (_dist) {
+            memset(_dist, 0, _capacity);
+        }
+        _size = 0;
+    }
+
+    template <typename Q>
+    iterator find(const Q &key) {
+        static_assert(is_lookup_key<Q>(), "heterogeneous lookup needs a transparent hash and key_equal");
+        return iterator(this, find_index(key));
+    }
+    template <typename Q>
+    const_iterator find(const Q &key) const {
+        static_assert(is_lookup_key<Q>(), "heterogeneous lookup needs a transparent hash and key_equal");
+        return const_iterator(this, find_index(key));
+    }
+
+    template <typename Q>
+    bool contains(const Q &key) const {
+        return find_index(key) != _capacity;
+    }
+
+    template <typename Q>
+    V &at(const Q &key) {
+        size_t i = find_index(key);
+        if (i == _capacity) {
+            throw std::out_of_range("Key not found");
+        }
+        return _slots[i].second;
+    }
+    template <typename Q>
+    const V &at(const Q &key) const {
+        size_t i = find_index(key);
+        if (i == _capacity) {
+            throw std::out_of_range("Key not found");
+        }
+        return _slots[i].second;
+    }
+
+    template <typename KK, typename... Args>
+    std::pair<iterator, bool> try_emplace(KK &&key, Args &&...args) {
+        size_t i = find_index(key);
+        if (i != _capacity) {
+            return {iterator(this, i), false};
+        }
+
+        if (_size + 1 > max_load()) {
+            grow();
+        }
+        K new_key(std::forward<KK>(key));
+        while ((i = insert_unique(std::move(new_key), std::forward<Args>(args)...)) == _capacity) {
+            grow();
+        }
+        ++_size;
+        return {iterator(this, i), true};
+    }
+
+    std::pair<iterator, bool> insert(const K &key, const V &value) {
+        return try_emplace(key, value);
+    }
+    std::pair<iterator, bool> insert(K &&key, V &&value) {
+        return try_emplace(std::move(key), std::move(value));
+    }
+
+    // inserts a default constructed value if the key is missing
+    V &operator[](const K &key) {
+        return try_emplace(key).first->second;
+    }
+    V &operator[](K &&key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template <typename Q>
+    bool erase(const Q &key) {
+        size_t pos = find_index(key);
+        if (pos == _capacity) {
+            return false;
+        }
+
+        // backward shift: pull the following entries one slot closer to
+        // their home until one is already home or the run ends
+        const size_t mask = _capacity - 1;
+        _slots[pos].~value_type();
+        size_t next = (pos + 1) & mask;
+        while (_dist[next] > 1) {
+            new (_slots + pos) value_type(std::move(_slots[next]));
+            _slots[next].~value_type();
+            _dist[pos] = _dist[next] - 1;
+            pos = next;
+            next = (next + 1) & mask;
+        }
+        _dist[pos] = 0;
+        --_size;
+        return true;
+    }
+};
+
 }
 
 #endif /* PHYBER_ENGINE_DATATYPES_H */
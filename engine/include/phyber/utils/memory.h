@@ -0,0 +1,66 @@
+#ifndef PHYBER_ENGINE_MEMORY_H
+#define PHYBER_ENGINE_MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// reservations at least this big are aligned to, and advised for,
+// transparent huge pages (Linux only)
+#ifndef PHYBER_ENGINE_HUGE_PAGE_SIZE
+#define PHYBER_ENGINE_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+namespace Phyber {
+namespace Memory {
+
+struct Stats {
+    size_t reserved_bytes;  // address space held by live VirtualBuffers
+    size_t committed_bytes; // of which readable/writable
+};
+
+extern size_t page_size();
+extern Stats get_stats();
+
+// a range of address space reserved up front and made usable (committed)
+// on demand. Because the range never moves, anything stored in it can grow
+// in place up to the reserved size without copying. Large reservations are
+// huge-page aligned and advised with MADV_HUGEPAGE on Linux
+class VirtualBuffer {
+private:
+    uint8_t *_base = nullptr;
+    size_t _reserved = 0;
+    size_t _committed = 0;
+
+public:
+    VirtualBuffer() {}
+    explicit VirtualBuffer(size_t max_bytes) { reserve(max_bytes); }
+    ~VirtualBuffer() { release(); }
+
+    VirtualBuffer(const VirtualBuffer &) = delete;
+    VirtualBuffer &operator=(const VirtualBuffer &) = delete;
+    VirtualBuffer(VirtualBuffer &&other) noexcept;
+    VirtualBuffer &operator=(VirtualBuffer &&other) noexcept;
+
+    void *data() const { return _base; }
+    size_t reserved() const { return _reserved; }
+    size_t committed() const { return _committed; }
+
+    // reserves address space for max_bytes (rounded up to whole pages).
+    // Throws std::bad_alloc on failure, releases any previous reservation
+    void reserve(size_t max_bytes);
+    // makes the first `bytes` bytes usable. Never shrinks, throws
+    // std::out_of_range if bytes is bigger than the reservation
+    void commit(size_t bytes);
+    // returns the pages past `bytes` to the OS, their contents are lost
+    void decommit(size_t bytes);
+    void release();
+
+    // bytes of the committed range currently backed by huge pages, read
+    // from /proc/self/smaps. Always 0 outside of Linux
+    size_t huge_page_bytes() const;
+};
+
+}
+}
+
+#endif /* PHYBER_ENGINE_MEMORY_H */
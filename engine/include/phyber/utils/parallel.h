@@ -0,0 +1,238 @@
+#ifndef PHYBER_ENGINE_PARALLEL_H
+#define PHYBER_ENGINE_PARALLEL_H
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <utility>
+
+#include "phyber/defs/global_defines.h"
+#include "phyber/utils/datatypes.h"
+#include "phyber/utils/thread_pool.h"
+
+// ranges with at most this many elements are processed inline on the
+// calling thread, bigger ranges are split into chunks of at least this size
+#ifndef PHYBER_ENGINE_PARALLEL_GRAIN_SIZE
+#define PHYBER_ENGINE_PARALLEL_GRAIN_SIZE 2048
+#endif
+
+namespace Phyber {
+
+namespace ParallelUtils {
+
+// chunks handed out per pool thread, more than one so threads that finish
+// early can pick up the slack
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+// splits [0, n) into chunks. Every chunk boundary falls on a cache line of
+// the array starting at `base` (when sizeof(T) divides the line size), so two
+// threads never write to the same line
+struct Chunking {
+    size_t n;
+    size_t head; // size of the first chunk, shortened to reach a line boundary
+    size_t step;
+    size_t count;
+
+    size_t begin(size_t k) const { return k == 0 ? 0 : head + (k - 1) * step; }
+    size_t end(size_t k) const {
+        size_t e = head + k * step;
+        return e < n ? e : n;
+    }
+};
+
+template <typename T>
+Chunking make_chunking(const T *base, size_t n, size_t grain, unsigned int threads) {
+    constexpr size_t LINE = PHYBER_ENGINE_CACHE_LINE_SIZE;
+    constexpr size_t per_line = (sizeof(T) <= LINE && LINE % sizeof(T) == 0) ? LINE / sizeof(T) : 1;
+
+    size_t target = (n + threads * CHUNKS_PER_THREAD - 1) / (threads * CHUNKS_PER_THREAD);
+    if (target < grain) { target = grain; }
+    if (target == 0) { target = 1; }
+    const size_t step = (target + per_line - 1) / per_line * per_line;
+
+    size_t off = 0;
+    const size_t misalign = reinterpret_cast<uintptr_t>(base) % LINE;
+    if (per_line > 1 && misalign % sizeof(T) == 0) {
+        off = misalign / sizeof(T);
+    }
+
+    Chunking c;
+    c.n = n;
+    c.head = step - off;
+    c.step = step;
+    c.count = n <= c.head ? 1 : 1 + (n - c.head + step - 1) / step;
+    return c;
+}
+
+template <typename T>
+struct alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) Partial {
+    std::optional<T> value;
+};
+
+}
+
+// calls f(std::span<T>) on consecutive chunks of data, in parallel on the
+// engine thread pool. Small ranges run inline as a single chunk
+template <typename T, typename F>
+void parallel_for_chunks(std::span<T> data, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    ThreadPool &pool = ThreadPool::global();
+    if (data.size() <= grain || pool.worker_count() == 0) {
+        if (!data.empty()) { f(data); }
+        return;
+    }
+
+    ParallelUtils::Chunking c = ParallelUtils::make_chunking(data.data(), data.size(), grain, pool.concurrency());
+    pool.run(c.count, [&](size_t k) {
+        f(data.subspan(c.begin(k), c.end(k) - c.begin(k)));
+    });
+}
+
+// calls f(i) for every i in [0, n)
+template <typename F>
+void parallel_for(size_t n, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    ThreadPool &pool = ThreadPool::global();
+    if (n <= grain || pool.worker_count() == 0) {
+        for (size_t i = 0; i < n; ++i) { f(i); }
+        return;
+    }
+
+    // no array to align to, the chunks only need to be big enough
+    ParallelUtils::Chunking c = ParallelUtils::make_chunking<uint8_t>(nullptr, n, grain, pool.concurrency());
+    pool.run(c.count, [&](size_t k) {
+        for (size_t i = c.begin(k), end = c.end(k); i < end; ++i) { f(i); }
+    });
+}
+
+// calls f(T &) for every element
+template <typename T, typename F>
+void parallel_for(std::span<T> data, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    parallel_for_chunks(data, [&](std::span<T> chunk) {
+        for (T &v : chunk) { f(v); }
+    }, grain);
+}
+
+template <typename T, typename F>
+void parallel_for(DynamicArray<T> &arr, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    parallel_for(std::span<T>(arr.begin(), arr.size()), std::forward<F>(f), grain);
+}
+
+// out[i] = f(in[i]). Chunks are aligned to the output, throws
+// std::invalid_argument if the sizes differ. in and out may be the same range
+template <typename In, typename Out, typename F>
+void parallel_transform(std::span<In> in, std::span<Out> out, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    if (in.size() != out.size()) {
+        throw std::invalid_argument("Size mismatch");
+    }
+    In *src = in.data();
+    Out *dst = out.data();
+    parallel_for_chunks(out, [&](std::span<Out> chunk) {
+        const In *s = src + (chunk.data() - dst);
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            chunk[i] = f(s[i]);
+        }
+    }, grain);
+}
+
+// resizes out to in.size() first
+template <typename T, typename U, typename F>
+void parallel_transform(const DynamicArray<T> &in, DynamicArray<U> &out, F &&f, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    out.resize(in.size());
+    parallel_transform(std::span<const T>(in.begin(), in.size()), std::span<U>(out.begin(), out.size()),
+        std::forward<F>(f), grain);
+}
+
+// init op data[0] op data[1] ... for an associative op. Chunks are folded
+// in parallel and the partial results combined in order, so op does not
+// have to be commutative
+template <typename T, typename Value, typename Op=std::plus<>>
+Value parallel_reduce(std::span<T> data, Value init, Op op={}, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    ThreadPool &pool = ThreadPool::global();
+    if (data.size() <= grain || pool.worker_count() == 0) {
+        for (const T &v : data) { init = op(std::move(init), v); }
+        return init;
+    }
+
+    // reads never share a line with writes, so the chunks only need to be
+    // big enough; the partials get a cache line each
+    ParallelUtils::Chunking c = ParallelUtils::make_chunking(data.data(), data.size(), grain, pool.concurrency());
+    std::unique_ptr<ParallelUtils::Partial<Value>[]> partials(new ParallelUtils::Partial<Value>[c.count]);
+    pool.run(c.count, [&](size_t k) {
+        size_t i = c.begin(k), end = c.end(k);
+        Value acc = data[i];
+        for (++i; i < end; ++i) { acc = op(std::move(acc), data[i]); }
+        partials[k].value.emplace(std::move(acc));
+    });
+
+    for (size_t k = 0; k < c.count; ++k) {
+        init = op(std::move(init), std::move(*partials[k].value));
+    }
+    return init;
+}
+
+template <typename T, typename Value, typename Op=std::plus<>>
+Value parallel_reduce(const DynamicArray<T> &arr, Value init, Op op={}, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    return parallel_reduce(std::span<const T>(arr.begin(), arr.size()), std::move(init), op, grain);
+}
+
+// inclusive scan, out[i] = in[0] op in[1] op ... op in[i] for an associative
+// op. Takes two passes: chunk totals in parallel, a serial prefix over the
+// totals, then every chunk is scanned again starting from its prefix.
+// in and out may be the same range
+template <typename In, typename T, typename Op=std::plus<>>
+void parallel_scan(std::span<In> in, std::span<T> out, Op op={}, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    if (in.size() != out.size()) {
+        throw std::invalid_argument("Size mismatch");
+    }
+    const size_t n = in.size();
+    if (n == 0) { return; }
+
+    auto scan = [&](size_t begin, size_t end, const T *carry) {
+        T acc = carry ? op(*carry, in[begin]) : T(in[begin]);
+        out[begin] = acc;
+        for (size_t i = begin + 1; i < end; ++i) {
+            acc = op(std::move(acc), in[i]);
+            out[i] = acc;
+        }
+    };
+
+    ThreadPool &pool = ThreadPool::global();
+    if (n <= grain || pool.worker_count() == 0) {
+        scan(0, n, nullptr);
+        return;
+    }
+
+    ParallelUtils::Chunking c = ParallelUtils::make_chunking(out.data(), n, grain, pool.concurrency());
+    std::unique_ptr<ParallelUtils::Partial<T>[]> partials(new ParallelUtils::Partial<T>[c.count]);
+
+    // the last chunk's total is never needed
+    pool.run(c.count - 1, [&](size_t k) {
+        size_t i = c.begin(k), end = c.end(k);
+        T acc = in[i];
+        for (++i; i < end; ++i) { acc = op(std::move(acc), in[i]); }
+        partials[k].value.emplace(std::move(acc));
+    });
+
+    // turn the totals into the carry into chunk k + 1
+    for (size_t k = 1; k + 1 < c.count; ++k) {
+        partials[k].value = op(*partials[k - 1].value, std::move(*partials[k].value));
+    }
+
+    pool.run(c.count, [&](size_t k) {
+        scan(c.begin(k), c.end(k), k == 0 ? nullptr : &*partials[k - 1].value);
+    });
+}
+
+// resizes out to in.size() first, in and out may be the same array
+template <typename T, typename Op=std::plus<>>
+void parallel_scan(const DynamicArray<T> &in, DynamicArray<T> &out, Op op={}, size_t grain=PHYBER_ENGINE_PARALLEL_GRAIN_SIZE) {
+    out.resize(in.size());
+    parallel_scan(std::span<const T>(in.begin(), in.size()), std::span<T>(out.begin(), out.size()), op, grain);
+}
+
+}
+
+#endif /* PHYBER_ENGINE_PARALLEL_H */
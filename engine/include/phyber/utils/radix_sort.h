@@ -0,0 +1,325 @@
+#ifndef PHYBER_ENGINE_RADIX_SORT_H
+#define PHYBER_ENGINE_RADIX_SORT_H
+
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "phyber/utils/datatypes.h"
+#include "phyber/utils/thread_pool.h"
+
+// below this many keys parallel_sort just sorts on the calling thread
+#ifndef PHYBER_ENGINE_RADIX_SORT_PARALLEL_THRESHOLD
+#define PHYBER_ENGINE_RADIX_SORT_PARALLEL_THRESHOLD 65536
+#endif
+
+namespace Phyber {
+namespace RadixSort {
+
+// maps a key to an unsigned integer with the same ordering
+template <typename Key, typename = void>
+struct KeyTraits;
+
+template <typename Key>
+struct KeyTraits<Key, std::enable_if_t<std::is_integral<Key>::value && std::is_unsigned<Key>::value>> {
+    typedef Key bits_t;
+    static bits_t to_bits(Key k) { return k; }
+};
+
+template <typename Key>
+struct KeyTraits<Key, std::enable_if_t<std::is_integral<Key>::value && std::is_signed<Key>::value>> {
+    typedef std::make_unsigned_t<Key> bits_t;
+    static bits_t to_bits(Key k) {
+        // flipping the sign bit puts negatives below positives
+        return static_cast<bits_t>(k) ^ (bits_t(1) << (sizeof(Key) * 8 - 1));
+    }
+};
+
+template <typename Key>
+struct KeyTraits<Key, std::enable_if_t<std::is_floating_point<Key>::value>> {
+    typedef std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t> bits_t;
+    static bits_t to_bits(Key k) {
+        bits_t b;
+        memcpy(&b, &k, sizeof(b));
+        // negatives: flip everything so bigger magnitudes sort first.
+        // positives: flip the sign bit so they sort after the negatives
+        const bits_t sign = bits_t(1) << (sizeof(Key) * 8 - 1);
+        return (b & sign) ? ~b : (b | sign);
+    }
+};
+
+// marks a keys-only sort
+struct NoValue {};
+
+namespace Internal {
+
+constexpr size_t RADIX = 256;
+
+template <typename Key>
+constexpr size_t passes() { return sizeof(typename KeyTraits<Key>::bits_t); }
+
+// histograms and offsets are 32 bit to keep them small in cache, so they
+// can't count more keys than this
+inline void check_size(size_t n) {
+    if constexpr (sizeof(size_t) > sizeof(uint32_t)) {
+        if (n > UINT32_MAX) {
+            throw std::length_error("RadixSort can't sort more than UINT32_MAX keys");
+        }
+    }
+}
+
+template <typename Key>
+inline size_t digit(Key k, size_t pass) {
+    return (KeyTraits<Key>::to_bits(k) >> (pass * 8)) & (RADIX - 1);
+}
+
+// counts every digit of every key in a single read of the input. Four
+// interleaved sets of counters break the dependency between consecutive
+// increments of the same bucket, which otherwise serializes the loop
+template <typename Key>
+void histogram(const Key *keys, size_t n, uint32_t (*counts)[RADIX]) {
+    constexpr size_t P = passes<Key>();
+    typedef typename KeyTraits<Key>::bits_t bits_t;
+
+    static thread_local uint32_t lanes[4][P][RADIX];
+    memset(lanes, 0, sizeof(lanes));
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        bits_t b0 = KeyTraits<Key>::to_bits(keys[i]);
+        bits_t b1 = KeyTraits<Key>::to_bits(keys[i + 1]);
+        bits_t b2 = KeyTraits<Key>::to_bits(keys[i + 2]);
+        bits_t b3 = KeyTraits<Key>::to_bits(keys[i + 3]);
+        for (size_t p = 0; p < P; ++p) {
+            ++lanes[0][p][(b0 >> (p * 8)) & (RADIX - 1)];
+            ++lanes[1][p][(b1 >> (p * 8)) & (RADIX - 1)];
+            ++lanes[2][p][(b2 >> (p * 8)) & (RADIX - 1)];
+            ++lanes[3][p][(b3 >> (p * 8)) & (RADIX - 1)];
+        }
+    }
+    for (; i < n; ++i) {
+        bits_t b = KeyTraits<Key>::to_bits(keys[i]);
+        for (size_t p = 0; p < P; ++p) {
+            ++lanes[0][p][(b >> (p * 8)) & (RADIX - 1)];
+        }
+    }
+
+    for (size_t p = 0; p < P; ++p) {
+        for (size_t d = 0; d < RADIX; ++d) {
+            counts[p][d] = lanes[0][p][d] + lanes[1][p][d] + lanes[2][p][d] + lanes[3][p][d];
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void scatter(const Key *keys, const Value *values, Key *keys_out, Value *values_out,
+             size_t begin, size_t end, size_t pass, uint32_t *offsets) {
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t dst = offsets[digit(keys[i], pass)]++;
+        keys_out[dst] = keys[i];
+        if constexpr (!std::is_same<Value, NoValue>::value) {
+            values_out[dst] = values[i];
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void sort(Key *keys, Value *values, size_t n, Key *key_scratch, Value *value_scratch) {
+    static_assert(std::is_trivially_copyable<Key>::value, "Key must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable");
+    constexpr size_t P = passes<Key>();
+    check_size(n);
+    if (n < 2) { return; }
+
+    uint32_t counts[P][RADIX];
+    histogram(keys, n, counts);
+
+    Key *src_k = keys, *dst_k = key_scratch;
+    Value *src_v = values, *dst_v = value_scratch;
+
+    for (size_t p = 0; p < P; ++p) {
+        // every key has the same digit here, the pass wouldn't move anything
+        if (counts[p][digit(keys[0], p)] == n) { continue; }
+
+        uint32_t offsets[RADIX];
+        uint32_t sum = 0;
+        for (size_t d = 0; d < RADIX; ++d) {
+            offsets[d] = sum;
+            sum += counts[p][d];
+        }
+
+        scatter(src_k, src_v, dst_k, dst_v, 0, n, p, offsets);
+        std::swap(src_k, dst_k);
+        std::swap(src_v, dst_v);
+    }
+
+    if (src_k != keys) {
+        memcpy(keys, src_k, n * sizeof(Key));
+        if constexpr (!std::is_same<Value, NoValue>::value) {
+            memcpy(values, src_v, n * sizeof(Value));
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void parallel_sort(Key *keys, Value *values, size_t n, Key *key_scratch, Value *value_scratch, unsigned int n_threads) {
+    constexpr size_t P = passes<Key>();
+    check_size(n);
+    ThreadPool &pool = ThreadPool::global();
+    if (n_threads == 0) {
+        n_threads = pool.concurrency();
+    }
+    if (n_threads <= 1 || n < PHYBER_ENGINE_RADIX_SORT_PARALLEL_THRESHOLD) {
+        sort(keys, values, n, key_scratch, value_scratch);
+        return;
+    }
+
+    const size_t chunk = (n + n_threads - 1) / n_threads;
+    DynamicArray<uint32_t> counts;
+    counts.resize(size_t(n_threads) * RADIX);
+
+    Key *src_k = keys, *dst_k = key_scratch;
+    Value *src_v = values, *dst_v = value_scratch;
+
+    for (size_t p = 0; p < P; ++p) {
+        // every thread counts the digits of its own slice
+        pool.run(n_threads, [&](size_t t) {
+            uint32_t *c = &counts[size_t(t) * RADIX];
+            memset(c, 0, RADIX * sizeof(uint32_t));
+            size_t end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+            for (size_t i = t * chunk; i < end; ++i) {
+                ++c[digit(src_k[i], p)];
+            }
+        });
+
+        // turn the counts into per-thread starting offsets: all of digit d
+        // from thread 0, then from thread 1, ...
+        uint32_t sum = 0;
+        bool trivial = false;
+        for (size_t d = 0; d < RADIX; ++d) {
+            uint32_t digit_total = 0;
+            for (unsigned int t = 0; t < n_threads; ++t) {
+                uint32_t c = counts[size_t(t) * RADIX + d];
+                counts[size_t(t) * RADIX + d] = sum;
+                sum += c;
+                digit_total += c;
+            }
+            trivial |= digit_total == n;
+        }
+        if (trivial) { continue; }
+
+        pool.run(n_threads, [&](size_t t) {
+            size_t end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+            if (t * chunk < end) {
+                scatter(src_k, src_v, dst_k, dst_v, t * chunk, end, p, &counts[size_t(t) * RADIX]);
+            }
+        });
+
+        std::swap(src_k, dst_k);
+        std::swap(src_v, dst_v);
+    }
+
+    if (src_k != keys) {
+        memcpy(keys, src_k, n * sizeof(Key));
+        if constexpr (!std::is_same<Value, NoValue>::value) {
+            memcpy(values, src_v, n * sizeof(Value));
+        }
+    }
+}
+
+template <typename T>
+T *scratch_for(DynamicArray<T> *scratch, DynamicArray<T> &local, size_t n) {
+    DynamicArray<T> &s = scratch ? *scratch : local;
+    if (s.size() < n) {
+        s.resize(n);
+    }
+    return s.begin();
+}
+
+}
+
+// Stable LSD radix sort, one pass per key byte. Passes where every key has
+// the same byte are skipped. Supports 8/16/32/64 bit integers, float and
+// double, at most UINT32_MAX keys (std::length_error otherwise). `scratch`
+// must hold n keys; when a DynamicArray is used it is resized as needed, so
+// keeping one around avoids allocating on every call
+template <typename Key>
+void sort(Key *keys, size_t n, Key *scratch) {
+    Internal::sort<Key, NoValue>(keys, nullptr, n, scratch, nullptr);
+}
+
+template <typename Key>
+void sort(DynamicArray<Key> &keys, std::type_identity_t<DynamicArray<Key>> *scratch=nullptr) {
+    DynamicArray<Key> local;
+    sort(keys.begin(), keys.size(), Internal::scratch_for(scratch, local, keys.size()));
+}
+
+// sorts keys and moves values along with them
+template <typename Key, typename Value>
+void sort_pairs(Key *keys, Value *values, size_t n, Key *key_scratch, Value *value_scratch) {
+    Internal::sort(keys, values, n, key_scratch, value_scratch);
+}
+
+template <typename Key, typename Value>
+void sort_pairs(DynamicArray<Key> &keys, DynamicArray<Value> &values,
+                std::type_identity_t<DynamicArray<Key>> *key_scratch=nullptr, std::type_identity_t<DynamicArray<Value>> *value_scratch=nullptr) {
+    if (keys.size() != values.size()) {
+        throw std::invalid_argument("keys and values must have the same size");
+    }
+    DynamicArray<Key> local_keys;
+    DynamicArray<Value> local_values;
+    size_t n = keys.size();
+    sort_pairs(keys.begin(), values.begin(), n,
+        Internal::scratch_for(key_scratch, local_keys, n),
+        Internal::scratch_for(value_scratch, local_values, n));
+}
+
+// fills `indices` with the order that sorts keys, leaving keys untouched,
+// e.g. to draw objects by their z coordinate
+template <typename Key>
+void sort_indices(const DynamicArray<Key> &keys, DynamicArray<uint32_t> &indices) {
+    size_t n = keys.size();
+    DynamicArray<Key> sorted_keys, key_scratch;
+    DynamicArray<uint32_t> index_scratch;
+    sorted_keys.resize(n);
+    if (n > 0) {
+        memcpy(sorted_keys.begin(), keys.begin(), n * sizeof(Key));
+    }
+    indices.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        indices[i] = static_cast<uint32_t>(i);
+    }
+    sort_pairs(sorted_keys, indices, &key_scratch, &index_scratch);
+}
+
+// same result as sort(), the histogram and scatter of every pass are split
+// into n_threads slices run on the engine thread pool (0 means one per pool
+// thread)
+template <typename Key>
+void parallel_sort(DynamicArray<Key> &keys, std::type_identity_t<DynamicArray<Key>> *scratch=nullptr, unsigned int n_threads=0) {
+    DynamicArray<Key> local;
+    Key *s = Internal::scratch_for(scratch, local, keys.size());
+    Internal::parallel_sort<Key, NoValue>(keys.begin(), nullptr, keys.size(), s, nullptr, n_threads);
+}
+
+template <typename Key, typename Value>
+void parallel_sort_pairs(DynamicArray<Key> &keys, DynamicArray<Value> &values,
+                         std::type_identity_t<DynamicArray<Key>> *key_scratch=nullptr, std::type_identity_t<DynamicArray<Value>> *value_scratch=nullptr,
+                         unsigned int n_threads=0) {
+    if (keys.size() != values.size()) {
+        throw std::invalid_argument("keys and values must have the same size");
+    }
+    DynamicArray<Key> local_keys;
+    DynamicArray<Value> local_values;
+    size_t n = keys.size();
+    Internal::parallel_sort(keys.begin(), values.begin(), n,
+        Internal::scratch_for(key_scratch, local_keys, n),
+        Internal::scratch_for(value_scratch, local_values, n), n_threads);
+}
+
+}
+}
+
+#endif /* PHYBER_ENGINE_RADIX_SORT_H */
@@ -0,0 +1,296 @@
+#ifndef PHYBER_ENGINE_RING_BUFFER_H
+#define PHYBER_ENGINE_RING_BUFFER_H
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+#include "phyber/defs/global_defines.h"
+
+namespace Phyber {
+
+namespace RingBufferUtils {
+
+inline size_t round_up_pow2(size_t v) {
+    size_t p = 2;
+    while (p < v) { p <<= 1; }
+    return p;
+}
+
+}
+
+// bounded single-producer single-consumer queue. Both sides are wait-free:
+// each only writes its own index and keeps a cached copy of the other one,
+// so the shared cache line is only touched when the cached value runs out.
+// Capacity is rounded up to a power of two
+template <typename T>
+class SPSCRingBuffer {
+    static_assert(std::is_move_constructible<T>::value, "T must be move constructible");
+
+private:
+    // consumer side
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<size_t> _head {0};
+    size_t _cached_tail = 0;
+
+    // producer side
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<size_t> _tail {0};
+    size_t _cached_head = 0;
+
+    // read-only after construction
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) T *_slots = nullptr;
+    size_t _mask = 0;
+
+    // producer: number of free slots, refreshing the cached head only if needed
+    size_t free_slots(size_t tail, size_t wanted) {
+        size_t free = _mask + 1 - (tail - _cached_head);
+        if (free < wanted) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            free = _mask + 1 - (tail - _cached_head);
+        }
+        return free;
+    }
+
+    // consumer: number of readable slots, refreshing the cached tail only if needed
+    size_t used_slots(size_t head, size_t wanted) {
+        size_t used = _cached_tail - head;
+        if (used < wanted) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            used = _cached_tail - head;
+        }
+        return used;
+    }
+
+public:
+    explicit SPSCRingBuffer(size_t capacity) {
+        size_t n = RingBufferUtils::round_up_pow2(capacity);
+        _slots = static_cast<T *>(::operator new(sizeof(T) * n, std::align_val_t(alignof(T))));
+        _mask = n - 1;
+    }
+
+    SPSCRingBuffer(const SPSCRingBuffer &) = delete;
+    SPSCRingBuffer &operator=(const SPSCRingBuffer &) = delete;
+
+    ~SPSCRingBuffer() {
+        if constexpr (!std::is_trivially_destructible<T>::value) {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            for (size_t i = _head.load(std::memory_order_relaxed); i != tail; ++i) {
+                _slots[i & _mask].~T();
+            }
+        }
+        ::operator delete(_slots, std::align_val_t(alignof(T)));
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+    // only a hint when called while the other side is running
+    size_t size_approx() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size_approx() == 0; }
+
+    template <typename... Args>
+    bool try_emplace(Args &&...args) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (free_slots(tail, 1) == 0) {
+            return false;
+        }
+        new (_slots + (tail & _mask)) T(std::forward<Args>(args)...);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T &v) { return try_emplace(v); }
+    bool try_push(T &&v) { return try_emplace(std::move(v)); }
+
+    bool try_pop(T &out) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (used_slots(head, 1) == 0) {
+            return false;
+        }
+        T *slot = _slots + (head & _mask);
+        out = std::move(*slot);
+        slot->~T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // copies up to n items and publishes them with a single store.
+    // Returns how many were pushed
+    size_t try_push_n(const T *items, size_t n) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t free = free_slots(tail, n);
+        if (n > free) { n = free; }
+        for (size_t i = 0; i < n; ++i) {
+            new (_slots + ((tail + i) & _mask)) T(items[i]);
+        }
+        if (n > 0) {
+            _tail.store(tail + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // moves up to n items into out and releases their slots with a single
+    // store. Returns how many were popped
+    size_t try_pop_n(T *out, size_t n) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        size_t used = used_slots(head, n);
+        if (n > used) { n = used; }
+        for (size_t i = 0; i < n; ++i) {
+            T *slot = _slots + ((head + i) & _mask);
+            out[i] = std::move(*slot);
+            slot->~T();
+        }
+        if (n > 0) {
+            _head.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+};
+
+// bounded multi-producer multi-consumer queue (Vyukov). Every slot carries a
+// sequence number telling whether it is ready to be written or read at a
+// given position; producers and consumers claim positions with a CAS on
+// their own cache-line-padded counter. Lock-free, capacity is rounded up to
+// a power of two
+template <typename T>
+class MPMCRingBuffer {
+    static_assert(std::is_move_constructible<T>::value, "T must be move constructible");
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_pos {0};
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_pos {0};
+    alignas(PHYBER_ENGINE_CACHE_LINE_SIZE) Cell *_cells = nullptr;
+    size_t _mask = 0;
+
+    // claims up to n consecutive positions whose cells have sequence
+    // pos + i + offset. A cell in that state can only be changed by whoever
+    // owns position pos + i, so a successful CAS hands all of them to us
+    size_t claim(std::atomic<size_t> &counter, size_t offset, size_t n, size_t &pos) {
+        pos = counter.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = 0;
+            while (ready < n) {
+                size_t seq = _cells[(pos + ready) & _mask].sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + ready + offset);
+                if (diff != 0) {
+                    if (ready == 0 && diff < 0) {
+                        // full (for producers) or empty (for consumers)
+                        return 0;
+                    }
+                    break;
+                }
+                ++ready;
+            }
+
+            if (ready == 0) {
+                // someone else already took pos, retry from the current one
+                pos = counter.load(std::memory_order_relaxed);
+            } else if (counter.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                return ready;
+            }
+        }
+    }
+
+public:
+    explicit MPMCRingBuffer(size_t capacity) {
+        size_t n = RingBufferUtils::round_up_pow2(capacity);
+        _cells = static_cast<Cell *>(::operator new(sizeof(Cell) * n, std::align_val_t(alignof(Cell))));
+        for (size_t i = 0; i < n; ++i) {
+            new (&_cells[i].sequence) std::atomic<size_t>(i);
+        }
+        _mask = n - 1;
+    }
+
+    MPMCRingBuffer(const MPMCRingBuffer &) = delete;
+    MPMCRingBuffer &operator=(const MPMCRingBuffer &) = delete;
+
+    ~MPMCRingBuffer() {
+        if constexpr (!std::is_trivially_destructible<T>::value) {
+            size_t end = _enqueue_pos.load(std::memory_order_relaxed);
+            for (size_t i = _dequeue_pos.load(std::memory_order_relaxed); i != end; ++i) {
+                _cells[i & _mask].value()->~T();
+            }
+        }
+        ::operator delete(_cells, std::align_val_t(alignof(Cell)));
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+    // only a hint when called while other threads are running
+    size_t size_approx() const {
+        size_t enq = _enqueue_pos.load(std::memory_order_acquire);
+        size_t deq = _dequeue_pos.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+    bool empty() const { return size_approx() == 0; }
+
+    template <typename... Args>
+    bool try_emplace(Args &&...args) {
+        size_t pos;
+        if (claim(_enqueue_pos, 0, 1, pos) == 0) {
+            return false;
+        }
+        Cell &cell = _cells[pos & _mask];
+        new (cell.storage) T(std::forward<Args>(args)...);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T &v) { return try_emplace(v); }
+    bool try_push(T &&v) { return try_emplace(std::move(v)); }
+
+    bool try_pop(T &out) {
+        size_t pos;
+        if (claim(_dequeue_pos, 1, 1, pos) == 0) {
+            return false;
+        }
+        Cell &cell = _cells[pos & _mask];
+        out = std::move(*cell.value());
+        cell.value()->~T();
+        cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // claims up to n consecutive slots with a single CAS. Returns how many
+    // items were pushed
+    size_t try_push_n(const T *items, size_t n) {
+        if (n == 0) { return 0; }
+        size_t pos;
+        n = claim(_enqueue_pos, 0, n, pos);
+        for (size_t i = 0; i < n; ++i) {
+            Cell &cell = _cells[(pos + i) & _mask];
+            new (cell.storage) T(items[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // claims up to n consecutive items with a single CAS. Returns how many
+    // items were popped
+    size_t try_pop_n(T *out, size_t n) {
+        if (n == 0) { return 0; }
+        size_t pos;
+        n = claim(_dequeue_pos, 1, n, pos);
+        for (size_t i = 0; i < n; ++i) {
+            Cell &cell = _cells[(pos + i) & _mask];
+            out[i] = std::move(*cell.value());
+            cell.value()->~T();
+            cell.sequence.store(pos + i + _mask + 1, std::memory_order_release);
+        }
+        return n;
+    }
+};
+
+}
+
+#endif /* PHYBER_ENGINE_RING_BUFFER_H */
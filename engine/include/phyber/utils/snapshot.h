@@ -0,0 +1,134 @@
+#ifndef PHYBER_ENGINE_SNAPSHOT_H
+#define PHYBER_ENGINE_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "phyber/utils/datatypes.h"
+
+// binary snapshots of arrays of plain structs. A snapshot is a 64 byte
+// header followed by the raw elements, aligned so the file can be mapped
+// and used in place:
+//
+//     Snapshot::save("tiles.bin", tiles);
+//     Snapshot::View<Tile> view("tiles.bin"); // pages load on first touch
+//     Tile t = view[42];
+//
+// Errors (missing file, bad magic or version, element size mismatch,
+// truncated file, checksum mismatch) throw std::runtime_error
+
+namespace Phyber {
+namespace Snapshot {
+
+constexpr uint32_t VERSION = 1;
+constexpr char MAGIC[8] = {'P', 'H', 'Y', 'S', 'N', 'A', 'P', '\0'};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t data_offset;   // from the start of the file
+    uint64_t element_size;
+    uint64_t element_align;
+    uint64_t count;
+    uint64_t checksum;      // of the element bytes
+    uint8_t reserved[16];
+};
+static_assert(sizeof(Header) == 64, "Snapshot header must stay 64 bytes");
+
+// 64 bit hash of the bytes, the same on every platform
+extern uint64_t checksum(const void *data, size_t size);
+
+// writes the header and elements to a temporary file next to path and
+// renames it over path once complete
+extern void write(const char *path, const void *data, size_t count, size_t element_size, size_t element_align);
+
+// a read-only mapping of a whole snapshot file, validated against the
+// element layout on open. The checksum is only compared if asked to, since
+// that reads every page
+class MappedFile {
+private:
+    void *_base = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    void *_mapping = nullptr;
+#endif
+    const Header *_header = nullptr;
+
+public:
+    MappedFile() {}
+    MappedFile(const char *path, size_t element_size, size_t element_align, bool verify_checksum);
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    void close();
+    bool is_open() const { return _base != nullptr; }
+
+    const Header &header() const { return *_header; }
+    const void *data() const { return static_cast<const uint8_t *>(_base) + _header->data_offset; }
+    size_t count() const { return _header ? _header->count : 0; }
+
+    // true if the elements still match the stored checksum
+    bool verify() const;
+};
+
+template <typename T>
+void save(const char *path, const DynamicArray<T> &arr) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots need trivially copyable elements");
+    write(path, arr.begin(), arr.size(), sizeof(T), alignof(T));
+}
+
+// replaces the contents of arr with the snapshot at path, checksum included
+template <typename T>
+void load(const char *path, DynamicArray<T> &arr) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots need trivially copyable elements");
+    MappedFile file(path, sizeof(T), alignof(T), true);
+    arr.resize(file.count());
+    if (file.count()) {
+        memcpy(arr.begin(), file.data(), file.count() * sizeof(T));
+    }
+}
+
+// read-only, zero-copy view of a snapshot file with the DynamicArray
+// indexing API. Elements are paged in by the OS as they are first touched
+template <typename T>
+class View {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots need trivially copyable elements");
+
+private:
+    MappedFile _file;
+
+public:
+    View() {}
+    explicit View(const char *path, bool verify_checksum=false)
+        : _file(path, sizeof(T), alignof(T), verify_checksum) {}
+
+    size_t size() const { return _file.count(); }
+    bool empty() const { return size() == 0; }
+    const T *data() const { return _file.is_open() ? static_cast<const T *>(_file.data()) : nullptr; }
+
+    const T *begin() const { return data(); }
+    const T *end() const { return data() + size(); }
+
+    const T &operator[](size_t pos) const { return data()[pos]; }
+    const T &at(size_t pos) const {
+        if (pos >= size()) {
+            throw std::out_of_range("Out of bounds");
+        }
+        return data()[pos];
+    }
+
+    bool verify() const { return _file.verify(); }
+    void close() { _file.close(); }
+};
+
+}
+}
+
+#endif /* PHYBER_ENGINE_SNAPSHOT_H */
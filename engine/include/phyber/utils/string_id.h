@@ -0,0 +1,108 @@
+#ifndef PHYBER_ENGINE_STRING_ID_H
+#define PHYBER_ENGINE_STRING_ID_H
+
+#include <compare>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+// when enabled every StringId built at runtime is checked against the
+// interned string with the same hash, and a clash throws std::logic_error
+#ifndef PHYBER_ENGINE_STRING_ID_CHECK_COLLISIONS
+#ifdef NDEBUG
+#define PHYBER_ENGINE_STRING_ID_CHECK_COLLISIONS 0
+#else
+#define PHYBER_ENGINE_STRING_ID_CHECK_COLLISIONS 1
+#endif
+#endif
+
+namespace Phyber {
+
+namespace StringIdUtils {
+
+// 64 bit FNV-1a, except that the empty string hashes to 0 so that
+// StringId("") is the same as StringId()
+constexpr uint64_t fnv1a(const char *str, size_t len) {
+    if (len == 0) { return 0; }
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<uint8_t>(str[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// length of a string held in a char array, stops at the first null
+constexpr size_t array_length(const char *str, size_t n) {
+    size_t len = 0;
+    while (len < n && str[len] != '\0') { ++len; }
+    return len;
+}
+
+// stores a copy of str for reverse lookups and returns its hash. With
+// collision checks on, throws std::logic_error if a different string with
+// the same hash was interned before. Thread safe
+extern uint64_t intern(std::string_view str);
+// the interned string for hash, or nullptr
+extern const char *lookup(uint64_t hash);
+// number of distinct strings interned so far
+extern size_t interned_count();
+
+}
+
+// a name reduced to a 64 bit hash, so comparing and hashing names costs a
+// single integer operation. Literals are hashed at compile time:
+//
+//     constexpr StringId PLAYER = "player";
+//     if (id == StringId("player")) ...
+//
+// Ids made from runtime strings go through the global interner so they can
+// be turned back into text with str(). Literal ids are only interned when
+// they are constructed at runtime with collision checks on
+class StringId {
+private:
+    uint64_t _hash = 0;
+
+    constexpr explicit StringId(uint64_t hash, int) : _hash(hash) {}
+
+public:
+    constexpr StringId() {}
+
+    template <size_t N>
+    constexpr StringId(const char (&literal)[N])
+        : _hash(StringIdUtils::fnv1a(literal, StringIdUtils::array_length(literal, N))) {
+#if PHYBER_ENGINE_STRING_ID_CHECK_COLLISIONS
+        if !consteval {
+            StringIdUtils::intern(std::string_view(literal, StringIdUtils::array_length(literal, N)));
+        }
+#endif
+    }
+
+    explicit StringId(std::string_view str) : _hash(StringIdUtils::intern(str)) {}
+
+    // an id from a stored hash, e.g. one read back from a file
+    static constexpr StringId from_hash(uint64_t hash) { return StringId(hash, 0); }
+
+    constexpr uint64_t hash() const { return _hash; }
+    // true for StringId() and for ids made from ""
+    constexpr bool empty() const { return _hash == 0; }
+
+    // the original text if it was interned, "<unknown>" otherwise. Meant
+    // for logs and debugging, never for lookups
+    const char *str() const;
+
+    constexpr bool operator==(const StringId &) const = default;
+    constexpr auto operator<=>(const StringId &) const = default;
+};
+
+}
+
+template <>
+struct std::hash<Phyber::StringId> {
+    size_t operator()(const Phyber::StringId &id) const noexcept {
+        return static_cast<size_t>(id.hash());
+    }
+};
+
+#endif /* PHYBER_ENGINE_STRING_ID_H */
@@ -0,0 +1,85 @@
+#ifndef PHYBER_ENGINE_THREAD_POOL_H
+#define PHYBER_ENGINE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "phyber/utils/datatypes.h"
+
+// workers in the engine wide pool, 0 picks one less than the number of
+// hardware threads
+#ifndef PHYBER_ENGINE_WORKER_THREADS
+#define PHYBER_ENGINE_WORKER_THREADS 0
+#endif
+
+namespace Phyber {
+
+// persistent worker threads that execute one batch of tasks at a time.
+// The calling thread works on the batch too, so a pool with N workers runs
+// tasks on N + 1 threads. Batches submitted from inside a task run inline
+class ThreadPool {
+private:
+    struct Job {
+        void (*fn)(void *ctx, size_t task) = nullptr;
+        void *ctx = nullptr;
+        size_t n_tasks = 0;
+    };
+
+    DynamicArray<std::thread> _workers;
+
+    std::mutex _run_mutex; // one batch at a time
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _finished;
+
+    Job _job;
+    uint64_t _generation = 0;
+    size_t _active = 0; // workers holding a copy of _job
+    bool _stop = false;
+    std::exception_ptr _error;
+
+    std::atomic<size_t> _next {0};
+    std::atomic<size_t> _remaining {0};
+
+    void worker_loop();
+    void execute(const Job &job);
+    void run_job(const Job &job);
+
+public:
+    // 0 workers means one less than the number of hardware threads
+    explicit ThreadPool(unsigned int n_workers=0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int worker_count() const { return static_cast<unsigned int>(_workers.size()); }
+    // threads that take part in a batch, workers plus the caller
+    unsigned int concurrency() const { return worker_count() + 1; }
+
+    // calls task(i) for every i in [0, n_tasks) and returns once all have
+    // finished. The first exception thrown by a task is rethrown here
+    template <typename F>
+    void run(size_t n_tasks, F &&task) {
+        if (n_tasks == 0) { return; }
+        Job job;
+        job.fn = [](void *ctx, size_t i) { (*static_cast<std::remove_reference_t<F> *>(ctx))(i); };
+        job.ctx = const_cast<void *>(static_cast<const void *>(&task));
+        job.n_tasks = n_tasks;
+        run_job(job);
+    }
+
+    // engine wide pool, created on first use
+    static ThreadPool &global();
+};
+
+}
+
+#endif /* PHYBER_ENGINE_THREAD_POOL_H */
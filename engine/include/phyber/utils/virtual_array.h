@@ -0,0 +1,168 @@
+#ifndef PHYBER_ENGINE_VIRTUAL_ARRAY_H
+#define PHYBER_ENGINE_VIRTUAL_ARRAY_H
+
+#include <new>
+#include <stddef.h>
+#include <stdexcept>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+#include "phyber/utils/memory.h"
+
+namespace Phyber {
+
+// array on a VirtualBuffer: address space for max_capacity elements is
+// reserved up front and pages are committed as the array grows, so growing
+// never moves or copies elements and pointers into it stay valid. Big
+// reservations are backed by huge pages where the OS allows it. Growing past
+// max_capacity throws std::length_error
+template <typename T>
+class VirtualArray {
+    static_assert(std::is_default_constructible<T>::value,
+                  "T must be default constructible");
+
+private:
+    Memory::VirtualBuffer _buffer;
+    T *_array = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0;
+    size_t _max_capacity = 0;
+
+    static constexpr bool is_trivially_simple() {
+        return std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value;
+    }
+
+    void destroy_range(size_t from, size_t to) {
+        if constexpr (!is_trivially_simple()) {
+            for (size_t i = from; i < to; ++i) {
+                _array[i].~T();
+            }
+        }
+    }
+
+    void _grow() {
+        size_t new_capacity = _capacity > 1 ? (_capacity * 3) / 2 : 2;
+        // use up whatever is left of the reservation before failing
+        if (new_capacity > _max_capacity && _capacity < _max_capacity) {
+            new_capacity = _max_capacity;
+        }
+        reserve(new_capacity);
+    }
+
+public:
+    explicit VirtualArray(size_t max_capacity)
+        : _buffer(max_capacity * sizeof(T)) {
+        _array = static_cast<T *>(_buffer.data());
+        _max_capacity = _buffer.reserved() / sizeof(T);
+    }
+
+    ~VirtualArray() {
+        destroy_range(0, _size);
+    }
+
+    VirtualArray(const VirtualArray &) = delete;
+    VirtualArray &operator=(const VirtualArray &) = delete;
+
+    size_t capacity() const { return _capacity; }
+    // at least the requested max_capacity, the reservation is rounded up to whole pages
+    size_t max_capacity() const { return _max_capacity; }
+    size_t size() const { return _size; }
+    const Memory::VirtualBuffer &buffer() const { return _buffer; }
+
+    T *begin() { return _array; }
+    T *end() { return _array + _size; }
+    const T *begin() const { return _array; }
+    const T *end() const { return _array + _size; }
+    const T &operator[](size_t index) const {
+        return _array[index];
+    }
+    T &operator[](size_t index) {
+        return _array[index];
+    }
+    const T &at(size_t index) const {
+        if (index >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        return _array[index];
+    }
+    T &at(size_t index) {
+        if (index >= _size) {
+            throw std::out_of_range("Out of bounds");
+        }
+        return _array[index];
+    }
+
+    // commits or decommits pages, like DynamicArray::reserve() it drops the
+    // elements that don't fit in new_capacity
+    void reserve(size_t new_capacity) {
+        if (new_capacity == _capacity) { return; }
+        if (new_capacity > _max_capacity) {
+            throw std::length_error("VirtualArray exceeds its reservation");
+        }
+
+        if (new_capacity > _capacity) {
+            _buffer.commit(new_capacity * sizeof(T));
+        } else {
+            if (_size > new_capacity) {
+                destroy_range(new_capacity, _size);
+                _size = new_capacity;
+            }
+            _buffer.decommit(new_capacity * sizeof(T));
+        }
+        _capacity = new_capacity;
+    }
+
+    void resize(size_t new_size) {
+        if (new_size > _capacity) {
+            reserve(new_size);
+        }
+
+        if constexpr (is_trivially_simple()) {
+            if (new_size > _size) {
+                memset(_array + _size, 0, (new_size - _size) * sizeof(T));
+            }
+        } else {
+            for (size_t i = _size; i < new_size; ++i) {
+                new (_array + i) T();
+            }
+            destroy_range(new_size, _size);
+        }
+        _size = new_size;
+    }
+
+    void shrink_to_fit() {
+        reserve(_size);
+    }
+
+    void clear() {
+        destroy_range(0, _size);
+        _size = 0;
+    }
+
+    void pop_back() {
+        if (_size > 0) {
+            destroy_range(_size - 1, _size);
+            --_size;
+        }
+    }
+
+    void push_back(const T &v) {
+        if (_size == _capacity) {
+            _grow();
+        }
+        new (_array + _size) T(v);
+        ++_size;
+    }
+    void push_back(T &&v) {
+        if (_size == _capacity) {
+            _grow();
+        }
+        new (_array + _size) T(std::move(v));
+        ++_size;
+    }
+};
+
+}
+
+#endif /* PHYBER_ENGINE_VIRTUAL_ARRAY_H */
@@ -2,6 +2,7 @@
 #include "phyber/2d/common.h"
 #include "phyber/math.h"
 #include "phyber/logging.h"
+#include "phyber/utils/memory.h"
 
 #include <SDL3/SDL.h>
 
@@ -12,6 +13,8 @@
 
 color_precision_t *Phyber::Renderer2d_cpu::buffer = nullptr;
 size_t buffer_pitch = 0;
+// backs Renderer2d_cpu::buffer, big frame buffers get huge pages
+Phyber::Memory::VirtualBuffer buffer_memory;
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
@@ -46,9 +49,12 @@ bool Phyber::Renderer2d_cpu::init(unsigned int width, unsigned int height) {
     }
 
     buffer_pitch = sizeof(color_precision_t) * width;
-    buffer = (color_precision_t*)malloc(buffer_pitch * height);
-    if (!buffer) {
-        PHYBER_LOG_CRITICAL("Coudln't allocate screen buffer");
+    try {
+        buffer_memory.reserve(buffer_pitch * height);
+        buffer_memory.commit(buffer_pitch * height);
+        buffer = (color_precision_t*)buffer_memory.data();
+    } catch (const std::exception &e) {
+        PHYBER_LOG_CRITICAL("Coudln't allocate screen buffer: %s", e.what());
         goto error;
     }
 
@@ -91,8 +97,8 @@ bool Phyber::Renderer2d_cpu::render() {
 
 
 void Phyber::Renderer2d_cpu::destroy() {
-    if (buffer)
-        free(buffer);
+    buffer_memory.release();
+    buffer = nullptr;
 
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
@@ -2,13 +2,13 @@
 #include "phyber/logging.h"
 #include <SDL3/SDL.h>
 
-bool Phyber::poll_event(Phyber::Event &event) {
-    SDL_Event sdl_event;
-    if (!SDL_PollEvent(&sdl_event)) {
-        return false;
-    }
+// events pulled from SDL per SDL_PeepEvents call
+static constexpr int PEEP_BATCH = 64;
 
-    // sdl_event
+static bool coalescing = false;
+static Phyber::DynamicArray<Phyber::MouseMotionEvent> raw_samples;
+
+static void translate(const SDL_Event &sdl_event, Phyber::Event &event) {
     switch (sdl_event.type) {
     case SDL_EventType::SDL_EVENT_QUIT:
     case SDL_EventType::SDL_EVENT_WINDOW_CLOSE_REQUESTED:
@@ -54,10 +54,131 @@ bool Phyber::poll_event(Phyber::Event &event) {
         event.type = Phyber::EventType::UNSUPPORTED;
         break;
     };
+}
 
+bool Phyber::poll_event(Phyber::Event &event) {
+    SDL_Event sdl_event;
+    if (!SDL_PollEvent(&sdl_event)) {
+        return false;
+    }
+    translate(sdl_event, event);
     return true;
 }
 
+// merges event into last when coalescing allows it, returns whether it did
+static bool coalesce(Phyber::Event &last, const Phyber::Event &event) {
+    if (last.type != event.type) {
+        return false;
+    }
+    if (event.type == Phyber::EventType::MOUSE_MOTION) {
+        if (last.mouse_motion.button_state != event.mouse_motion.button_state) {
+            return false;
+        }
+        last.mouse_motion.x = event.mouse_motion.x;
+        last.mouse_motion.y = event.mouse_motion.y;
+        last.mouse_motion.dx += event.mouse_motion.dx;
+        last.mouse_motion.dy += event.mouse_motion.dy;
+        return true;
+    }
+    if (event.type == Phyber::EventType::MOUSE_WHEEL) {
+        if (last.mouse_wheel.direction != event.mouse_wheel.direction) {
+            return false;
+        }
+        last.mouse_wheel.x += event.mouse_wheel.x;
+        last.mouse_wheel.y += event.mouse_wheel.y;
+        last.mouse_wheel.integer_x += event.mouse_wheel.integer_x;
+        last.mouse_wheel.integer_y += event.mouse_wheel.integer_y;
+        last.mouse_wheel.mouse_x = event.mouse_wheel.mouse_x;
+        last.mouse_wheel.mouse_y = event.mouse_wheel.mouse_y;
+        return true;
+    }
+    return false;
+}
+
+// translates into event, returns false if it was merged into last instead
+static bool translate_coalesced(const SDL_Event &sdl_event, Phyber::Event &event, Phyber::Event *last) {
+    translate(sdl_event, event);
+    if (!coalescing) {
+        return true;
+    }
+    if (event.type == Phyber::EventType::MOUSE_MOTION) {
+        raw_samples.push_back(event.mouse_motion);
+    }
+    return !last || !coalesce(*last, event);
+}
+
+void Phyber::set_event_coalescing(bool enabled) {
+    coalescing = enabled;
+    raw_samples.clear();
+}
+
+bool Phyber::is_event_coalescing() {
+    return coalescing;
+}
+
+const Phyber::DynamicArray<Phyber::MouseMotionEvent> &Phyber::raw_motion_samples() {
+    return raw_samples;
+}
+
+size_t Phyber::poll_events(Phyber::Event *out, size_t max) {
+    SDL_PumpEvents();
+    raw_samples.clear();
+    SDL_Event sdl_events[PEEP_BATCH];
+    size_t count = 0;
+    // merged events free up room, so pull until out is full
+    while (count < max) {
+        const int want = max - count < PEEP_BATCH ? static_cast<int>(max - count) : PEEP_BATCH;
+        const int n = SDL_PeepEvents(sdl_events, want, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+        for (int i = 0; i < n; ++i) {
+            if (translate_coalesced(sdl_events[i], out[count], count ? &out[count - 1] : nullptr)) {
+                ++count;
+            }
+        }
+        if (n < want) {
+            return count;
+        }
+    }
+    // out is full, events that merge into the last one don't need room
+    while (coalescing && count > 0) {
+        SDL_Event sdl_event;
+        Phyber::Event event;
+        if (SDL_PeepEvents(&sdl_event, 1, SDL_PEEKEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST) != 1) {
+            break;
+        }
+        translate(sdl_event, event);
+        if (!coalesce(out[count - 1], event)) {
+            break;
+        }
+        SDL_PeepEvents(&sdl_event, 1, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+        if (event.type == Phyber::EventType::MOUSE_MOTION) {
+            raw_samples.push_back(event.mouse_motion);
+        }
+    }
+    return count;
+}
+
+size_t Phyber::poll_events(DynamicArray<Phyber::Event> &out) {
+    SDL_PumpEvents();
+    raw_samples.clear();
+    SDL_Event sdl_events[PEEP_BATCH];
+    const size_t start = out.size();
+    int n;
+    do {
+        n = SDL_PeepEvents(sdl_events, PEEP_BATCH, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+        if (n <= 0) {
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            Phyber::Event event;
+            Phyber::Event *last = out.size() > start ? &out[out.size() - 1] : nullptr;
+            if (translate_coalesced(sdl_events[i], event, last)) {
+                out.push_back(event);
+            }
+        }
+    } while (n == PEEP_BATCH);
+    return out.size() - start;
+}
+
 const char *Phyber::KeyboardEvent::KeySymbol::get_key_name() const {
     SDL_Keycode sdl_virtual_key = static_cast<SDL_Keycode>(virtual_key);
     return SDL_GetKeyName(sdl_virtual_key);
@@ -0,0 +1,81 @@
+#include "phyber/input.h"
+
+using namespace Phyber;
+
+void Phyber::InputState::begin_frame() {
+    previous_keys = keys;
+    pressed.clear_all();
+    released.clear_all();
+    mouse_dx = mouse_dy = 0;
+    wheel_x = wheel_y = 0;
+    buttons_pressed = buttons_released = 0;
+    quit = false;
+}
+
+void Phyber::InputState::apply(const Event &event) {
+    switch (event.type) {
+    case EventType::KEYBOARD: {
+        const Key key = event.keyboard.key.physical_key;
+        modifiers = event.keyboard.key.key_modifier;
+        if (!valid_key(key) || event.keyboard.repeat) {
+            break;
+        }
+        const bool held = keys.test(key);
+        if (event.keyboard.down) {
+            if (!held) { pressed.set(key); }
+            keys.set(key);
+        } else {
+            if (held) { released.set(key); }
+            keys.clear(key);
+        }
+        break;
+    }
+    case EventType::MOUSE_MOTION:
+        mouse_x = event.mouse_motion.x;
+        mouse_y = event.mouse_motion.y;
+        mouse_dx += event.mouse_motion.dx;
+        mouse_dy += event.mouse_motion.dy;
+        break;
+    case EventType::MOUSE_BUTTON: {
+        mouse_x = event.mouse_button.x;
+        mouse_y = event.mouse_button.y;
+        if (!valid_button(event.mouse_button.button)) {
+            break;
+        }
+        const uint32_t bit = button_bit(event.mouse_button.button);
+        if (event.mouse_button.down) {
+            if (!(buttons & bit)) { buttons_pressed |= bit; }
+            buttons |= bit;
+        } else {
+            if (buttons & bit) { buttons_released |= bit; }
+            buttons &= ~bit;
+        }
+        break;
+    }
+    case EventType::MOUSE_WHEEL:
+        wheel_x += event.mouse_wheel.x;
+        wheel_y += event.mouse_wheel.y;
+        mouse_x = event.mouse_wheel.mouse_x;
+        mouse_y = event.mouse_wheel.mouse_y;
+        break;
+    case EventType::QUIT_EVENT:
+        quit = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void Phyber::InputState::update(const Event *events, size_t count) {
+    begin_frame();
+    for (size_t i = 0; i < count; ++i) {
+        apply(events[i]);
+    }
+}
+
+size_t Phyber::poll_input(InputState &state, DynamicArray<Event> &events) {
+    const size_t start = events.size();
+    const size_t count = poll_events(events);
+    state.update(events.begin() + start, count);
+    return count;
+}
@@ -0,0 +1,489 @@
+#include "phyber/logging.h"
+#include "phyber/log/binary.h"
+#include "phyber/log/byte_queue.h"
+#include "phyber/log/record.h"
+#include "phyber/log/sink.h"
+#include "phyber/utils/datatypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+using namespace Phyber;
+using namespace Phyber::Log;
+
+// bytes of formatted output collected before it is written out
+static constexpr size_t BATCH_SIZE = 64 * 1024;
+
+namespace {
+
+struct ProducerQueue {
+    ByteQueue queue;
+    std::atomic<uint64_t> dropped {0};
+    std::atomic<bool> closed {false}; // owning thread exited or replaced it
+    uint32_t generation;
+
+    ProducerQueue(size_t bytes, uint32_t gen) : queue(bytes), generation(gen) {}
+};
+
+struct AsyncState {
+    std::atomic<bool> enabled {false};
+    AsyncConfig config;
+    // bumped by start_async(), older queues are replaced on their next use
+    std::atomic<uint32_t> generation {0};
+
+    std::mutex queues_mutex;
+    DynamicArray<ProducerQueue *> queues;
+    // bumped whenever a queue is added so the writer refreshes its copy
+    std::atomic<uint64_t> queues_version {0};
+
+    std::mutex control_mutex; // start/stop
+    std::thread writer;
+    std::atomic<bool> stop {false};
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    uint64_t flush_requested = 0;
+    uint64_t flush_done = 0;
+
+    std::atomic<uint64_t> dropped_total {0};
+
+    FILE *output = nullptr; // binary log file, if any
+};
+
+}
+
+// never destroyed, threads may log during static destruction
+static AsyncState &state() {
+    static AsyncState *s = new AsyncState();
+    return *s;
+}
+
+// set once the thread's QueueOwner is gone, later thread_local destructors
+// on the thread log synchronously
+static thread_local bool thread_exiting = false;
+
+// closes the queue of an exiting thread, the writer frees it once drained
+struct QueueOwner {
+    ProducerQueue *queue = nullptr;
+    ~QueueOwner() {
+        if (queue) {
+            queue->closed.store(true, std::memory_order_release);
+            queue = nullptr;
+        }
+        thread_exiting = true;
+    }
+};
+
+static thread_local QueueOwner owner;
+
+// the calling thread's queue, nullptr during thread teardown
+static ProducerQueue *thread_queue(AsyncState &s) {
+    if (thread_exiting) {
+        return nullptr;
+    }
+    const uint32_t generation = s.generation.load(std::memory_order_relaxed);
+    if (!owner.queue || owner.queue->generation != generation) {
+        if (owner.queue) {
+            owner.queue->closed.store(true, std::memory_order_release);
+        }
+        ProducerQueue *q = new ProducerQueue(s.config.queue_bytes, generation);
+        std::lock_guard<std::mutex> lock(s.queues_mutex);
+        s.queues.push_back(q);
+        s.queues_version.fetch_add(1, std::memory_order_release);
+        owner.queue = q;
+    }
+    return owner.queue;
+}
+
+// space for a record of the given size in the calling thread's queue,
+// nullptr if it was dropped
+static void *reserve_record(AsyncState &s, ProducerQueue *pq, size_t size) {
+    if (size > pq->queue.max_message()) {
+        pq->dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    void *slot = pq->queue.reserve(size);
+    if (!slot) {
+        if (s.config.overflow == OverflowPolicy::DROP) {
+            pq->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    while (!slot) {
+        // nothing drains the queue once stop_async() has joined the writer
+        if (!s.enabled.load(std::memory_order_acquire)) {
+            s.dropped_total.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        // don't wait for the writer's idle poll
+        s.wake.notify_one();
+        std::this_thread::yield();
+        slot = pq->queue.reserve(size);
+    }
+    return slot;
+}
+
+bool Phyber::Log::async_vlog(Level level, const char *file, unsigned int line, const char *format, va_list args) {
+    AsyncState &s = state();
+    if (!s.enabled.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    ProducerQueue *pq = thread_queue(s);
+    if (!pq) { return false; }
+    void *slot = reserve_record(s, pq, sizeof(RecordHeader) + PHYBER_ENGINE_LOG_MAX_MESSAGE);
+    if (!slot) { return true; }
+
+    RecordHeader *record = static_cast<RecordHeader *>(slot);
+    char *message = reinterpret_cast<char *>(record + 1);
+    int len = vsnprintf(message, PHYBER_ENGINE_LOG_MAX_MESSAGE, format, args);
+    if (len < 0) { len = 0; }
+    if (len >= PHYBER_ENGINE_LOG_MAX_MESSAGE) { len = PHYBER_ENGINE_LOG_MAX_MESSAGE - 1; }
+
+    record->kind = RecordKind::TEXT;
+    record->level = level;
+    record->reserved = 0;
+    record->line = line;
+    record->file = file;
+    record->timestamp = timestamp_now();
+    record->thread = thread_id();
+    record->payload_size = static_cast<uint32_t>(len);
+    record->site = nullptr;
+    pq->queue.commit(sizeof(RecordHeader) + len);
+    return true;
+}
+
+std::atomic<bool> Phyber::Log::deferred_mode {false};
+
+uint8_t *Phyber::Log::async_begin(const Site &site, RecordKind kind, size_t args_size, bool &dropped) {
+    AsyncState &s = state();
+    dropped = false;
+    if (!s.enabled.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    ProducerQueue *pq = thread_queue(s);
+    if (!pq) { return nullptr; }
+    void *slot = reserve_record(s, pq, sizeof(RecordHeader) + args_size);
+    if (!slot) {
+        dropped = true;
+        return nullptr;
+    }
+
+    RecordHeader *record = static_cast<RecordHeader *>(slot);
+    record->kind = kind;
+    record->level = site.level;
+    record->reserved = 0;
+    record->line = site.line;
+    record->file = site.file;
+    record->timestamp = timestamp_now();
+    record->thread = thread_id();
+    record->payload_size = static_cast<uint32_t>(args_size);
+    record->site = &site;
+    return reinterpret_cast<uint8_t *>(record + 1);
+}
+
+void Phyber::Log::async_commit(size_t args_size) {
+    owner.queue->queue.commit(sizeof(RecordHeader) + args_size);
+}
+
+uint8_t *Phyber::Log::deferred_begin(const Site &site, size_t args_size, bool &dropped) {
+    return async_begin(site, RecordKind::DEFERRED, args_size, dropped);
+}
+
+void Phyber::Log::deferred_commit(size_t args_size) {
+    async_commit(args_size);
+}
+
+namespace {
+
+// writer side: collects formatted records, or binary log entries, and
+// writes them in large chunks. Text goes to the current sink
+class Batch {
+private:
+    FILE *_out; // binary mode only
+    bool _binary;
+    char *_buffer;
+    size_t _used = 0;
+    // binary mode: id of every site already written to the file
+    FlatHashMap<const Site *, uint32_t> _sites;
+
+    void put(const void *src, size_t size) {
+        if (BATCH_SIZE - _used < size) {
+            write_out();
+            if (size > BATCH_SIZE) {
+                fwrite(src, 1, size, _out);
+                return;
+            }
+        }
+        memcpy(_buffer + _used, src, size);
+        _used += size;
+    }
+
+    template <typename T>
+    void put(T value) {
+        put(&value, sizeof(value));
+    }
+
+    uint32_t site_id(const Site &site) {
+        auto it = _sites.find(&site);
+        if (it != _sites.end()) {
+            return it->second;
+        }
+        const uint32_t id = static_cast<uint32_t>(_sites.size());
+        _sites.insert(&site, id);
+        const uint16_t file_len = static_cast<uint16_t>(strnlen(site.file, UINT16_MAX));
+        const uint16_t format_len = static_cast<uint16_t>(strnlen(site.format, UINT16_MAX));
+        put(Binary::Entry::SITE);
+        put(id);
+        put(site.level);
+        put(static_cast<uint32_t>(site.line));
+        put(file_len);
+        put(format_len);
+        put(site.file, file_len);
+        put(site.format, format_len);
+        return id;
+    }
+
+    void add_binary(const RecordHeader &record) {
+        if (record.kind == RecordKind::DEFERRED || record.kind == RecordKind::FIELDS) {
+            if (record.payload_size > Binary::MAX_ARGS_LENGTH) {
+                state().dropped_total.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const uint32_t id = site_id(*record.site);
+            put(record.kind == RecordKind::FIELDS ? Binary::Entry::FIELDS : Binary::Entry::RECORD);
+            put(id);
+            put(record.timestamp);
+            put(record.thread);
+            put(record.payload_size);
+            put(record.payload(), record.payload_size);
+        } else {
+            const uint16_t file_len = static_cast<uint16_t>(strnlen(record.file, UINT16_MAX));
+            put(Binary::Entry::TEXT);
+            put(record.level);
+            put(record.line);
+            put(record.timestamp);
+            put(record.thread);
+            put(file_len);
+            put(record.payload_size);
+            put(record.file, file_len);
+            put(record.payload(), record.payload_size);
+        }
+    }
+
+public:
+    Batch(FILE *out, bool binary) : _out(out), _binary(binary), _buffer(static_cast<char *>(malloc(BATCH_SIZE))) {
+        if (_binary) {
+            put(Binary::MAGIC, sizeof(Binary::MAGIC));
+            put(Binary::VERSION);
+        }
+    }
+    ~Batch() { free(_buffer); }
+
+    void add(const RecordHeader &record) {
+        if (_binary) {
+            add_binary(record);
+            return;
+        }
+        if (BATCH_SIZE - _used < RECORD_TEXT_MAX) {
+            write_out();
+        }
+        _used += format_record(record, _buffer + _used, BATCH_SIZE - _used, current_sink().format());
+    }
+
+    void write_out() {
+        if (_binary) {
+            if (_used) {
+                fwrite(_buffer, 1, _used, _out);
+                _used = 0;
+            }
+            fflush(_out);
+            return;
+        }
+        Sink &sink = current_sink();
+        if (_used) {
+            sink.write(_buffer, _used);
+            _used = 0;
+        }
+        sink.flush();
+    }
+};
+
+}
+
+// drains every queue once, returns the number of records written. Sets
+// any_closed if one of the queues belongs to a thread that has exited
+static size_t drain(DynamicArray<ProducerQueue *> &queues, Batch &batch, bool &any_closed) {
+    size_t count = 0;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        // checked first: once closed is seen every record is already visible
+        any_closed |= queues[i]->closed.load(std::memory_order_acquire);
+        ByteQueue &q = queues[i]->queue;
+        size_t size;
+        while (const void *msg = q.peek(size)) {
+            batch.add(*static_cast<const RecordHeader *>(msg));
+            q.pop();
+            ++count;
+        }
+    }
+    return count;
+}
+
+static void report_drops(DynamicArray<ProducerQueue *> &queues, Batch &batch) {
+    AsyncState &s = state();
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        dropped += queues[i]->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (!dropped) { return; }
+    s.dropped_total.fetch_add(dropped, std::memory_order_relaxed);
+
+    struct {
+        RecordHeader header;
+        char message[96];
+    } record;
+    int len = snprintf(record.message, sizeof(record.message), "%llu log records dropped, async queue full",
+        static_cast<unsigned long long>(dropped));
+    record.header.kind = RecordKind::TEXT;
+    record.header.level = Level::WARNING;
+    record.header.reserved = 0;
+    record.header.line = __LINE__;
+    record.header.file = __FILE__;
+    record.header.timestamp = timestamp_now();
+    record.header.thread = 0;
+    record.header.payload_size = static_cast<uint32_t>(len);
+    record.header.site = nullptr;
+    batch.add(record.header);
+}
+
+// frees the queues of threads that exited once they are empty
+static void reap_closed(DynamicArray<ProducerQueue *> &local) {
+    AsyncState &s = state();
+    std::lock_guard<std::mutex> lock(s.queues_mutex);
+    for (size_t i = 0; i < s.queues.size(); ) {
+        ProducerQueue *q = s.queues[i];
+        if (q->closed.load(std::memory_order_acquire) && q->queue.empty()) {
+            s.queues[i] = s.queues[s.queues.size() - 1];
+            s.queues.pop_back();
+            delete q;
+        } else {
+            ++i;
+        }
+    }
+    local.clear();
+    for (ProducerQueue *q : s.queues) { local.push_back(q); }
+}
+
+static void writer_loop() {
+    AsyncState &s = state();
+    Batch batch(s.output, s.output != nullptr);
+    DynamicArray<ProducerQueue *> local;
+    uint64_t seen_version = ~0ull;
+    bool any_closed = false;
+
+    for (;;) {
+        uint64_t flush_ticket;
+        {
+            std::lock_guard<std::mutex> lock(s.wake_mutex);
+            flush_ticket = s.flush_requested;
+        }
+        const bool stopping = s.stop.load(std::memory_order_acquire);
+
+        uint64_t version = s.queues_version.load(std::memory_order_acquire);
+        if (version != seen_version || any_closed) {
+            reap_closed(local);
+            seen_version = version;
+            any_closed = false;
+        }
+
+        size_t written = drain(local, batch, any_closed);
+        report_drops(local, batch);
+        batch.write_out();
+
+        {
+            std::unique_lock<std::mutex> lock(s.wake_mutex);
+            if (flush_ticket > s.flush_done) {
+                s.flush_done = flush_ticket;
+                s.flushed.notify_all();
+            }
+            if (stopping) { return; }
+            if (written == 0 && s.flush_requested == s.flush_done) {
+                s.wake.wait_for(lock, std::chrono::microseconds(s.config.idle_sleep_us));
+            }
+        }
+    }
+}
+
+void Phyber::Log::start_async(const AsyncConfig &config) {
+    AsyncState &s = state();
+    std::lock_guard<std::mutex> lock(s.control_mutex);
+    if (s.writer.joinable()) { return; }
+
+    if (config.binary_path) {
+        s.output = fopen(config.binary_path, "wb");
+        if (!s.output) {
+            throw std::runtime_error("Failed to open binary log");
+        }
+    }
+    s.config = config;
+    s.generation.fetch_add(1, std::memory_order_relaxed);
+    s.stop.store(false, std::memory_order_relaxed);
+    s.writer = std::thread(writer_loop);
+    s.enabled.store(true, std::memory_order_release);
+    deferred_mode.store(config.defer_formatting || config.binary_path, std::memory_order_relaxed);
+}
+
+void Phyber::Log::stop_async() {
+    AsyncState &s = state();
+    std::lock_guard<std::mutex> lock(s.control_mutex);
+    if (!s.writer.joinable()) { return; }
+
+    deferred_mode.store(false, std::memory_order_relaxed);
+    s.enabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> wake_lock(s.wake_mutex);
+        s.stop.store(true, std::memory_order_release);
+    }
+    s.wake.notify_all();
+    s.writer.join();
+    if (s.output) {
+        fclose(s.output);
+        s.output = nullptr;
+    }
+}
+
+bool Phyber::Log::is_async() {
+    return state().enabled.load(std::memory_order_relaxed);
+}
+
+void Phyber::Log::flush() {
+    AsyncState &s = state();
+    if (!s.enabled.load(std::memory_order_acquire)) {
+        current_sink().flush();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(s.wake_mutex);
+    const uint64_t ticket = ++s.flush_requested;
+    s.wake.notify_all();
+    s.flushed.wait(lock, [&] {
+        return s.flush_done >= ticket || s.stop.load(std::memory_order_relaxed);
+    });
+}
+
+uint64_t Phyber::Log::dropped_count() {
+    return state().dropped_total.load(std::memory_order_relaxed);
+}
+
+// drains and joins the writer at exit, so queued records aren't lost
+static struct AsyncShutdown {
+    ~AsyncShutdown() { stop_async(); }
+} async_shutdown;
@@ -0,0 +1,400 @@
+#include "phyber/logging.h"
+#include "phyber/log/args.h"
+#include "phyber/log/binary.h"
+#include "phyber/log/record.h"
+#include "phyber/utils/datatypes.h"
+
+#include <charconv>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Phyber;
+using namespace Phyber::Log;
+
+namespace {
+
+// appends to out[pos, size) like snprintf, always leaving room for the
+// null terminator
+struct Output {
+    char *out;
+    size_t size;
+    size_t pos = 0;
+
+    template <typename... A>
+    void print(const char *spec, A... args) {
+        if (pos + 1 >= size) { return; }
+        int n = snprintf(out + pos, size - pos, spec, args...);
+        if (n < 0) { return; }
+        pos += static_cast<size_t>(n);
+        if (pos > size - 1) { pos = size - 1; }
+    }
+
+    void put(const char *src, size_t len) {
+        if (pos + 1 >= size) { return; }
+        if (len > size - 1 - pos) { len = size - 1 - pos; }
+        memcpy(out + pos, src, len);
+        pos += len;
+    }
+};
+
+}
+
+int64_t Phyber::Log::Args::Value::as_int() const {
+    if (type == Type::DOUBLE) {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return static_cast<int64_t>(d);
+    }
+    return static_cast<int64_t>(bits);
+}
+
+double Phyber::Log::Args::Value::as_double() const {
+    if (type == Type::DOUBLE) {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+    if (type == Type::INT) { return static_cast<double>(static_cast<int64_t>(bits)); }
+    return static_cast<double>(bits);
+}
+
+bool Phyber::Log::Args::next(const uint8_t *&p, const uint8_t *end, Value &value) {
+    if (p >= end) { return false; }
+    value.type = static_cast<Type>(*p++);
+    if (value.type == Type::STRING) {
+        if (end - p < 4) { return false; }
+        memcpy(&value.len, p, 4);
+        p += 4;
+        if (static_cast<size_t>(end - p) < value.len) { return false; }
+        value.str = reinterpret_cast<const char *>(p);
+        p += value.len;
+    } else {
+        if (end - p < 8) { return false; }
+        memcpy(&value.bits, p, 8);
+        p += 8;
+        value.str = nullptr;
+        value.len = 0;
+    }
+    return true;
+}
+
+char *Phyber::Log::Args::number_to_chars(const Value &value, char *out) {
+    char *last = out + 32;
+    switch (value.type) {
+    case Type::INT:
+        return std::to_chars(out, last, static_cast<int64_t>(value.bits)).ptr;
+    case Type::DOUBLE:
+        return std::to_chars(out, last, value.as_double()).ptr;
+    case Type::POINTER:
+        out[0] = '0';
+        out[1] = 'x';
+        return std::to_chars(out + 2, last, value.bits, 16).ptr;
+    default:
+        return std::to_chars(out, last, value.bits).ptr;
+    }
+}
+
+// integer arguments are widened to 64 bits when encoded, narrow them back
+// to what the length modifier says so e.g. %x of -1 prints ffffffff
+static uint64_t narrow(uint64_t value, const char *length, bool is_signed) {
+    if (strcmp(length, "hh") == 0) {
+        return is_signed ? static_cast<uint64_t>(static_cast<signed char>(value)) : static_cast<unsigned char>(value);
+    }
+    if (strcmp(length, "h") == 0) {
+        return is_signed ? static_cast<uint64_t>(static_cast<short>(value)) : static_cast<unsigned short>(value);
+    }
+    if (length[0] == '\0') {
+        return is_signed ? static_cast<uint64_t>(static_cast<int>(value)) : static_cast<unsigned int>(value);
+    }
+    return value;
+}
+
+size_t Phyber::Log::Args::format(const char *format, const uint8_t *args, size_t args_size, char *out, size_t size) {
+    if (size == 0) { return 0; }
+    Output o {out, size};
+    const uint8_t *end = args + args_size;
+
+    const char *p = format;
+    while (*p) {
+        const char *literal = p;
+        while (*p && *p != '%') { ++p; }
+        o.put(literal, p - literal);
+        if (!*p) { break; }
+
+        ++p;
+        if (*p == '%') {
+            o.put("%", 1);
+            ++p;
+            continue;
+        }
+
+        // rebuilt conversion, without the length modifier and with any
+        // '*' replaced by the value from the arguments
+        char spec[64];
+        size_t n = 0;
+        spec[n++] = '%';
+        while (*p && strchr("-+ #0'", *p)) {
+            if (n < 8) { spec[n++] = *p; }
+            ++p;
+        }
+        Args::Value arg;
+        if (*p == '*') {
+            ++p;
+            if (Args::next(args, end, arg)) {
+                n += snprintf(spec + n, 16, "%d", static_cast<int>(arg.as_int()));
+            }
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                if (n < 24) { spec[n++] = *p; }
+                ++p;
+            }
+        }
+        int precision = -1;
+        if (*p == '.') {
+            ++p;
+            precision = 0;
+            if (*p == '*') {
+                ++p;
+                if (Args::next(args, end, arg)) { precision = static_cast<int>(arg.as_int()); }
+            } else {
+                while (*p >= '0' && *p <= '9') {
+                    precision = precision * 10 + (*p - '0');
+                    ++p;
+                }
+            }
+        }
+        char length[3] = {};
+        size_t length_len = 0;
+        while (*p && strchr("hlLqjzt", *p)) {
+            if (length_len < 2) { length[length_len++] = *p; }
+            ++p;
+        }
+        const char conv = *p;
+        if (!conv) { break; }
+        ++p;
+
+        if (conv == 'n' || !Args::next(args, end, arg)) { continue; }
+
+        if (conv == 's') {
+            const char *str = arg.type == Args::Type::STRING ? arg.str : "";
+            int len = static_cast<int>(arg.len);
+            if (precision >= 0 && precision < len) { len = precision; }
+            memcpy(spec + n, ".*s", 4);
+            o.print(spec, len, str);
+            continue;
+        }
+
+        if (precision >= 0) {
+            n += snprintf(spec + n, 16, ".%d", precision);
+        }
+        switch (conv) {
+        case 'd': case 'i':
+            memcpy(spec + n, "lld", 4);
+            o.print(spec, static_cast<long long>(narrow(arg.as_int(), length, true)));
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conv;
+            spec[n] = '\0';
+            o.print(spec, static_cast<unsigned long long>(narrow(arg.as_int(), length, false)));
+            break;
+        case 'c':
+            memcpy(spec + n, "c", 2);
+            o.print(spec, static_cast<int>(arg.as_int()));
+            break;
+        case 'p':
+            memcpy(spec + n, "p", 2);
+            o.print(spec, reinterpret_cast<void *>(static_cast<uintptr_t>(arg.bits)));
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec[n++] = conv;
+            spec[n] = '\0';
+            o.print(spec, arg.as_double());
+            break;
+        default:
+            break;
+        }
+    }
+
+    out[o.pos] = '\0';
+    return o.pos;
+}
+
+namespace {
+
+// sequential reads of a binary log, any short read marks it as failed
+struct Reader {
+    FILE *in;
+    bool failed = false;
+
+    bool read(void *dst, size_t size) {
+        if (!failed && fread(dst, 1, size, in) != size) { failed = true; }
+        return !failed;
+    }
+
+    template <typename T>
+    T get() {
+        T value {};
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    // reads len bytes and null terminates them
+    char *get_string(size_t len) {
+        char *str = static_cast<char *>(malloc(len + 1));
+        if (!str) { throw std::bad_alloc(); }
+        read(str, len);
+        str[len] = '\0';
+        return str;
+    }
+};
+
+struct DecodedSite {
+    Level level;
+    uint32_t line;
+    char *file;
+    char *format;
+};
+
+}
+
+long long Phyber::Log::Binary::decode(FILE *in, FILE *out, Format format) {
+    Reader r {in};
+    char magic[sizeof(MAGIC)];
+    if (!r.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) { return -1; }
+    if (r.get<uint32_t>() != VERSION || r.failed) { return -1; }
+
+    DynamicArray<DecodedSite> sites;
+    // record header with its payload, the same layout format_text expects
+    uint64_t *record_buffer = nullptr;
+    size_t record_capacity = 0;
+    char text[RECORD_TEXT_MAX];
+    long long count = 0;
+    bool valid = true;
+
+    auto record_with_payload = [&](size_t payload_size) {
+        size_t need = (sizeof(RecordHeader) + payload_size + 7) / 8;
+        if (need > record_capacity) {
+            uint64_t *buffer = static_cast<uint64_t *>(realloc(record_buffer, need * 8));
+            if (!buffer) { throw std::bad_alloc(); }
+            record_buffer = buffer;
+            record_capacity = need;
+        }
+        return reinterpret_cast<RecordHeader *>(record_buffer);
+    };
+
+    int type;
+    while ((type = fgetc(in)) != EOF) {
+        if (type == static_cast<int>(Entry::SITE)) {
+            uint32_t id = r.get<uint32_t>();
+            Level level = static_cast<Level>(r.get<uint8_t>());
+            uint32_t line = r.get<uint32_t>();
+            uint16_t file_len = r.get<uint16_t>();
+            uint16_t format_len = r.get<uint16_t>();
+            char *file = r.get_string(file_len);
+            char *format = r.get_string(format_len);
+            // ids are handed out in order
+            if (r.failed || id != sites.size()) {
+                free(file);
+                free(format);
+                valid = false;
+                break;
+            }
+            sites.push_back({level, line, file, format});
+        } else if (type == static_cast<int>(Entry::RECORD) || type == static_cast<int>(Entry::FIELDS)) {
+            uint32_t id = r.get<uint32_t>();
+            uint64_t timestamp = r.get<uint64_t>();
+            uint32_t thread = r.get<uint32_t>();
+            uint32_t args_len = r.get<uint32_t>();
+            if (r.failed || id >= sites.size() || args_len > MAX_ARGS_LENGTH) {
+                valid = false;
+                break;
+            }
+            RecordHeader *record = record_with_payload(args_len);
+            if (!r.read(record + 1, args_len)) {
+                valid = false;
+                break;
+            }
+            const DecodedSite &decoded = sites[id];
+            const Site site {decoded.level, decoded.line, decoded.file, decoded.format};
+            record->kind = type == static_cast<int>(Entry::FIELDS) ? RecordKind::FIELDS : RecordKind::DEFERRED;
+            record->level = site.level;
+            record->reserved = 0;
+            record->line = site.line;
+            record->file = site.file;
+            record->timestamp = timestamp;
+            record->thread = thread;
+            record->payload_size = args_len;
+            record->site = &site;
+            fwrite(text, 1, format_record(*record, text, sizeof(text), format), out);
+            ++count;
+        } else if (type == static_cast<int>(Entry::TEXT)) {
+            Level level = static_cast<Level>(r.get<uint8_t>());
+            uint32_t line = r.get<uint32_t>();
+            uint64_t timestamp = r.get<uint64_t>();
+            uint32_t thread = r.get<uint32_t>();
+            uint16_t file_len = r.get<uint16_t>();
+            uint32_t text_len = r.get<uint32_t>();
+            if (r.failed || text_len > PHYBER_ENGINE_LOG_MAX_MESSAGE) {
+                valid = false;
+                break;
+            }
+            char *file = r.get_string(file_len);
+            RecordHeader *record = record_with_payload(text_len);
+            if (!r.read(record + 1, text_len)) {
+                free(file);
+                valid = false;
+                break;
+            }
+            record->kind = RecordKind::TEXT;
+            record->level = level;
+            record->reserved = 0;
+            record->line = line;
+            record->file = file;
+            record->timestamp = timestamp;
+            record->thread = thread;
+            record->payload_size = text_len;
+            record->site = nullptr;
+            fwrite(text, 1, format_record(*record, text, sizeof(text), format), out);
+            free(file);
+            ++count;
+        } else if (type == static_cast<int>(Entry::FRAME)) {
+            uint64_t frame = r.get<uint64_t>();
+            uint64_t timestamp = r.get<uint64_t>();
+            uint32_t thread = r.get<uint32_t>();
+            if (r.failed) {
+                valid = false;
+                break;
+            }
+            // shown as a DEBUG line "frame 123"
+            RecordHeader *record = record_with_payload(32);
+            char *message = reinterpret_cast<char *>(record + 1);
+            memcpy(message, "frame ", 6);
+            char *end = std::to_chars(message + 6, message + 32, frame).ptr;
+            record->kind = RecordKind::TEXT;
+            record->level = Level::DEBUG;
+            record->reserved = 0;
+            record->line = 0;
+            record->file = "frame";
+            record->timestamp = timestamp;
+            record->thread = thread;
+            record->payload_size = static_cast<uint32_t>(end - message);
+            record->site = nullptr;
+            fwrite(text, 1, format_record(*record, text, sizeof(text), format), out);
+            ++count;
+        } else {
+            valid = false;
+            break;
+        }
+    }
+
+    for (DecodedSite &site : sites) {
+        free(site.file);
+        free(site.format);
+    }
+    free(record_buffer);
+    return valid ? count : -1;
+}
@@ -0,0 +1,158 @@
+#include "phyber/logging.h"
+#include "phyber/log/record.h"
+#include "phyber/utils/datatypes.h"
+
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Phyber;
+using namespace Phyber::Log;
+
+namespace {
+
+struct Rule {
+    char *pattern;
+    Level level;
+    bool is_file;
+};
+
+struct Filter {
+    std::mutex mutex;
+    Level level = Level::DEBUG;
+    // flight recorder level, sites below the output level are recorded
+    bool recording = false;
+    Level recorded_level = Level::DEBUG;
+    DynamicArray<Rule> rules;
+    // every site that has been called at least once
+    DynamicArray<Site *> sites;
+};
+
+}
+
+// never destroyed, sites register from any thread at any time
+static Filter &filter() {
+    static Filter *f = new Filter();
+    return *f;
+}
+
+static bool is_separator(char c) {
+    return c == '/' || c == '\\';
+}
+
+// "renderer.cpp" matches ".../2d/renderer.cpp" but not ".../2d/my_renderer.cpp"
+static bool file_matches(const char *path, const char *pattern) {
+    size_t path_len = strlen(path);
+    size_t pattern_len = strlen(pattern);
+    if (pattern_len > path_len) { return false; }
+    const char *tail = path + path_len - pattern_len;
+    if (strcmp(tail, pattern) != 0) { return false; }
+    return tail == path || is_separator(tail[-1]);
+}
+
+// any directory of the path equals module
+static bool module_matches(const char *path, const char *module) {
+    size_t module_len = strlen(module);
+    const char *component = path;
+    for (const char *p = path; *p; ++p) {
+        if (is_separator(*p)) {
+            if (static_cast<size_t>(p - component) == module_len && memcmp(component, module, module_len) == 0) {
+                return true;
+            }
+            component = p + 1;
+        }
+    }
+    return false;
+}
+
+static Level level_for(const Filter &f, const char *path) {
+    // later rules override earlier ones of the same kind
+    const Rule *file_rule = nullptr;
+    const Rule *module_rule = nullptr;
+    for (const Rule &rule : f.rules) {
+        if (rule.is_file) {
+            if (file_matches(path, rule.pattern)) { file_rule = &rule; }
+        } else if (module_matches(path, rule.pattern)) {
+            module_rule = &rule;
+        }
+    }
+    if (file_rule) { return file_rule->level; }
+    if (module_rule) { return module_rule->level; }
+    return f.level;
+}
+
+static void update_site(const Filter &f, Site &site) {
+    SiteState state = SiteState::DISABLED;
+    if (site.level >= level_for(f, site.file)) {
+        state = SiteState::ENABLED;
+    } else if (f.recording && site.level >= f.recorded_level) {
+        state = SiteState::RECORDED;
+    }
+    site.state.store(state, std::memory_order_relaxed);
+}
+
+static void update_sites(Filter &f) {
+    for (Site *site : f.sites) {
+        update_site(f, *site);
+    }
+}
+
+static void add_rule(const char *pattern, Level level, bool is_file) {
+    Filter &f = filter();
+    std::lock_guard<std::mutex> lock(f.mutex);
+    for (size_t i = 0; i < f.rules.size(); ++i) {
+        if (f.rules[i].is_file == is_file && strcmp(f.rules[i].pattern, pattern) == 0) {
+            free(f.rules[i].pattern);
+            f.rules.erase(i);
+            break;
+        }
+    }
+    char *copy = strdup(pattern);
+    if (!copy) { throw std::bad_alloc(); }
+    f.rules.push_back({copy, level, is_file});
+    update_sites(f);
+}
+
+void Phyber::Log::set_level(Level level) {
+    Filter &f = filter();
+    std::lock_guard<std::mutex> lock(f.mutex);
+    f.level = level;
+    update_sites(f);
+}
+
+void Phyber::Log::set_module_level(const char *module, Level level) {
+    add_rule(module, level, false);
+}
+
+void Phyber::Log::set_file_level(const char *file, Level level) {
+    add_rule(file, level, true);
+}
+
+void Phyber::Log::clear_levels() {
+    Filter &f = filter();
+    std::lock_guard<std::mutex> lock(f.mutex);
+    for (Rule &rule : f.rules) {
+        free(rule.pattern);
+    }
+    f.rules.clear();
+    update_sites(f);
+}
+
+void Phyber::Log::set_recorded_level(bool recording, Level level) {
+    Filter &f = filter();
+    std::lock_guard<std::mutex> lock(f.mutex);
+    f.recording = recording;
+    f.recorded_level = level;
+    update_sites(f);
+}
+
+bool Phyber::Log::register_site(Site &site) {
+    Filter &f = filter();
+    std::lock_guard<std::mutex> lock(f.mutex);
+    // another thread may have registered it while we waited
+    if (site.state.load(std::memory_order_relaxed) == SiteState::UNKNOWN) {
+        f.sites.push_back(&site);
+        update_site(f, site);
+    }
+    return site.state.load(std::memory_order_relaxed) != SiteState::DISABLED;
+}
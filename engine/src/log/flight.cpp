@@ -0,0 +1,377 @@
+#include "phyber/logging.h"
+#include "phyber/log/binary.h"
+#include "phyber/log/flight.h"
+#include "phyber/log/record.h"
+
+#include <atomic>
+#include <errno.h>
+#include <signal.h>
+#include <stdexcept>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Phyber::Log;
+
+std::atomic<bool> Phyber::Log::flight_mode {false};
+
+namespace {
+
+enum class SlotKind : uint8_t {
+    ARGS,   // encoded arguments for site->format
+    FIELDS, // encoded key, value pairs
+    TEXT,   // formatted message
+    FRAME   // payload is the uint64 frame number
+};
+
+constexpr size_t SLOT_SIZE = 256;
+
+struct Slot {
+    uint64_t timestamp;
+    const Site *site; // nullptr for frame markers
+    uint32_t thread;
+    uint16_t size;    // of the payload
+    SlotKind kind;
+    uint8_t reserved;
+    uint8_t payload[SLOT_SIZE - 24];
+};
+static_assert(sizeof(Slot) == SLOT_SIZE, "Slot must stay 256 bytes");
+
+// only the owning thread writes, head is published after the slot is filled
+struct Ring {
+    Slot slots[PHYBER_ENGINE_LOG_FLIGHT_RECORDS];
+    std::atomic<uint64_t> head {0}; // records ever written
+    std::atomic<bool> in_use {true};
+    Ring *next = nullptr;
+    // dump cursor, only touched while dumping
+    uint64_t dump_pos = 0;
+    uint64_t dump_end = 0;
+};
+
+// every ring ever made, never freed so a dump can always walk the list.
+// Rings of finished threads keep their records until a new thread takes
+// them over
+std::atomic<Ring *> rings {nullptr};
+
+struct ThreadRing {
+    Ring *ring = nullptr;
+
+    ~ThreadRing() {
+        if (ring) { ring->in_use.store(false, std::memory_order_release); }
+    }
+};
+
+thread_local ThreadRing thread_ring;
+
+}
+
+static Ring *claim_ring() {
+    for (Ring *ring = rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        bool expected = false;
+        if (ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return ring;
+        }
+    }
+    Ring *ring = new Ring();
+    ring->next = rings.load(std::memory_order_relaxed);
+    while (!rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {}
+    return ring;
+}
+
+static Slot &next_slot(const Site *site, SlotKind kind) {
+    Ring *&ring = thread_ring.ring;
+    if (!ring) { ring = claim_ring(); }
+    Slot &slot = ring->slots[ring->head.load(std::memory_order_relaxed) % PHYBER_ENGINE_LOG_FLIGHT_RECORDS];
+    slot.timestamp = timestamp_now();
+    slot.site = site;
+    slot.thread = thread_id();
+    slot.size = 0;
+    slot.kind = kind;
+    return slot;
+}
+
+static void publish() {
+    Ring *ring = thread_ring.ring;
+    ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint8_t *Phyber::Log::flight_begin(const Site &site, size_t args_size, bool fields) {
+    Slot &slot = next_slot(&site, fields ? SlotKind::FIELDS : SlotKind::ARGS);
+    if (args_size > sizeof(slot.payload)) {
+        // the arguments are lost, keep the format and say so instead of
+        // dumping it with every conversion empty
+        static constexpr char MARKER[] = " [args truncated]";
+        constexpr size_t marker_len = sizeof(MARKER) - 1;
+        size_t len = strnlen(site.format, sizeof(slot.payload) - marker_len);
+        memcpy(slot.payload, site.format, len);
+        memcpy(slot.payload + len, MARKER, marker_len);
+        slot.kind = SlotKind::TEXT;
+        slot.size = static_cast<uint16_t>(len + marker_len);
+        publish();
+        return nullptr;
+    }
+    slot.size = static_cast<uint16_t>(args_size);
+    return slot.payload;
+}
+
+void Phyber::Log::flight_commit() {
+    publish();
+}
+
+void Phyber::Log::flight_text(const Site &site, const char *message, size_t len) {
+    Slot &slot = next_slot(&site, SlotKind::TEXT);
+    if (len > sizeof(slot.payload)) { len = sizeof(slot.payload); }
+    memcpy(slot.payload, message, len);
+    slot.size = static_cast<uint16_t>(len);
+    publish();
+}
+
+void Phyber::Log::frame_marker(uint64_t frame) {
+    if (!flight_mode.load(std::memory_order_relaxed)) {
+        return;
+    }
+    Slot &slot = next_slot(nullptr, SlotKind::FRAME);
+    memcpy(slot.payload, &frame, sizeof(frame));
+    slot.size = sizeof(frame);
+    publish();
+}
+
+void Phyber::Log::start_flight_recorder(Level level) {
+    set_recorded_level(true, level);
+    flight_mode.store(true, std::memory_order_relaxed);
+}
+
+void Phyber::Log::stop_flight_recorder() {
+    flight_mode.store(false, std::memory_order_relaxed);
+    set_recorded_level(false, Level::DEBUG);
+}
+
+bool Phyber::Log::is_flight_recording() {
+    return flight_mode.load(std::memory_order_relaxed);
+}
+
+// everything below may run in a signal handler: no allocation, no stdio,
+// no locks. The dump state is static, a second dump at the same time fails
+
+namespace {
+
+constexpr size_t DUMP_BUFFER_SIZE = 64 * 1024;
+// sites get an id the first time they show up, once the table is full
+// every record writes its site again under a new id
+constexpr size_t DUMP_SITES = 1024;
+
+std::atomic<bool> dumping {false};
+
+class DumpWriter {
+private:
+    static char _buffer[DUMP_BUFFER_SIZE];
+    static const Site *_sites[DUMP_SITES];
+    int _fd;
+    size_t _used = 0;
+    uint32_t _site_count = 0; // ids handed out
+    bool _ok = true;
+
+    void write_fd(const char *data, size_t size) {
+        while (size && _ok) {
+#if defined(_WIN32)
+            const int n = _write(_fd, data, static_cast<unsigned int>(size > (1u << 30) ? (1u << 30) : size));
+#else
+            const ssize_t n = ::write(_fd, data, size);
+            if (n < 0 && errno == EINTR) { continue; }
+#endif
+            if (n <= 0) {
+                _ok = false;
+                return;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    void put(const void *src, size_t size) {
+        if (DUMP_BUFFER_SIZE - _used < size) {
+            flush();
+            if (size > DUMP_BUFFER_SIZE) {
+                write_fd(static_cast<const char *>(src), size);
+                return;
+            }
+        }
+        memcpy(_buffer + _used, src, size);
+        _used += size;
+    }
+
+    template <typename T>
+    void put(T value) {
+        put(&value, sizeof(value));
+    }
+
+    uint32_t site_id(const Site &site) {
+        const uint32_t known = _site_count < DUMP_SITES ? _site_count : DUMP_SITES;
+        for (uint32_t i = 0; i < known; ++i) {
+            if (_sites[i] == &site) { return i; }
+        }
+        const uint32_t id = _site_count++;
+        if (id < DUMP_SITES) { _sites[id] = &site; }
+        const uint16_t file_len = static_cast<uint16_t>(strnlen(site.file, UINT16_MAX));
+        const uint16_t format_len = static_cast<uint16_t>(strnlen(site.format, UINT16_MAX));
+        put(Binary::Entry::SITE);
+        put(id);
+        put(site.level);
+        put(static_cast<uint32_t>(site.line));
+        put(file_len);
+        put(format_len);
+        put(site.file, file_len);
+        put(site.format, format_len);
+        return id;
+    }
+
+public:
+    DumpWriter(int fd) : _fd(fd) {
+        put(Binary::MAGIC, sizeof(Binary::MAGIC));
+        put(Binary::VERSION);
+    }
+
+    void add(const Slot &slot) {
+        if (slot.kind == SlotKind::FRAME) {
+            uint64_t frame;
+            memcpy(&frame, slot.payload, sizeof(frame));
+            put(Binary::Entry::FRAME);
+            put(frame);
+            put(slot.timestamp);
+            put(slot.thread);
+        } else if (slot.kind == SlotKind::TEXT) {
+            const Site &site = *slot.site;
+            const uint16_t file_len = static_cast<uint16_t>(strnlen(site.file, UINT16_MAX));
+            put(Binary::Entry::TEXT);
+            put(site.level);
+            put(static_cast<uint32_t>(site.line));
+            put(slot.timestamp);
+            put(slot.thread);
+            put(file_len);
+            put(static_cast<uint32_t>(slot.size));
+            put(site.file, file_len);
+            put(slot.payload, slot.size);
+        } else {
+            const uint32_t id = site_id(*slot.site);
+            put(slot.kind == SlotKind::FIELDS ? Binary::Entry::FIELDS : Binary::Entry::RECORD);
+            put(id);
+            put(slot.timestamp);
+            put(slot.thread);
+            put(static_cast<uint32_t>(slot.size));
+            put(slot.payload, slot.size);
+        }
+    }
+
+    void flush() {
+        write_fd(_buffer, _used);
+        _used = 0;
+    }
+
+    bool ok() const { return _ok; }
+};
+
+char DumpWriter::_buffer[DUMP_BUFFER_SIZE];
+const Site *DumpWriter::_sites[DUMP_SITES];
+
+}
+
+bool Phyber::Log::dump_flight_recorder(int fd) {
+    if (dumping.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+    Ring *first = rings.load(std::memory_order_acquire);
+    for (Ring *ring = first; ring; ring = ring->next) {
+        ring->dump_end = ring->head.load(std::memory_order_acquire);
+        ring->dump_pos = ring->dump_end > PHYBER_ENGINE_LOG_FLIGHT_RECORDS
+            ? ring->dump_end - PHYBER_ENGINE_LOG_FLIGHT_RECORDS : 0;
+    }
+
+    // merges the rings by timestamp, there are only a few of them
+    DumpWriter writer(fd);
+    for (;;) {
+        Ring *oldest = nullptr;
+        uint64_t oldest_time = 0;
+        for (Ring *ring = first; ring; ring = ring->next) {
+            if (ring->dump_pos == ring->dump_end) { continue; }
+            const uint64_t time = ring->slots[ring->dump_pos % PHYBER_ENGINE_LOG_FLIGHT_RECORDS].timestamp;
+            if (!oldest || time < oldest_time) {
+                oldest = ring;
+                oldest_time = time;
+            }
+        }
+        if (!oldest) { break; }
+        writer.add(oldest->slots[oldest->dump_pos++ % PHYBER_ENGINE_LOG_FLIGHT_RECORDS]);
+    }
+    writer.flush();
+
+    dumping.store(false, std::memory_order_release);
+    return writer.ok();
+}
+
+// crash handler
+
+static const int CRASH_SIGNALS[] = {SIGSEGV, SIGFPE, SIGILL, SIGABRT,
+#if !defined(_WIN32)
+    SIGBUS
+#endif
+};
+
+static char crash_path[4096];
+
+static void crash_handler(int sig) {
+    const int saved_errno = errno;
+#if defined(_WIN32)
+    int fd = _open(crash_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd >= 0) {
+        dump_flight_recorder(fd);
+        _close(fd);
+    }
+#else
+    int fd = ::open(crash_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        dump_flight_recorder(fd);
+        ::close(fd);
+    }
+#endif
+    errno = saved_errno;
+    // the handler was reset to the default one, which ends the process
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+void Phyber::Log::install_crash_handler(const char *path) {
+    const size_t len = strlen(path);
+    if (len >= sizeof(crash_path)) {
+        throw std::runtime_error("Crash dump path is too long");
+    }
+    memcpy(crash_path, path, len + 1);
+
+#if defined(_WIN32)
+    for (int sig : CRASH_SIGNALS) {
+        signal(sig, crash_handler);
+    }
+#else
+    // a stack overflow leaves no room for the handler on the thread's own
+    // stack, give the installing thread a separate one
+    static char alt_stack[64 * 1024];
+    stack_t ss {};
+    ss.ss_sp = alt_stack;
+    ss.ss_size = sizeof(alt_stack);
+    sigaltstack(&ss, nullptr);
+
+    struct sigaction action {};
+    action.sa_handler = crash_handler;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int sig : CRASH_SIGNALS) {
+        sigaction(sig, &action, nullptr);
+    }
+#endif
+}
@@ -0,0 +1,151 @@
+#include "phyber/logging.h"
+#include "phyber/log/args.h"
+#include "phyber/log/record.h"
+
+#include <charconv>
+#include <math.h>
+#include <string.h>
+
+using namespace Phyber::Log;
+
+namespace {
+
+// appends to out up to limit, a piece that doesn't fit isn't written
+struct JsonWriter {
+    char *out;
+    size_t limit;
+    size_t pos = 0;
+
+    bool put(const char *src, size_t len) {
+        if (len > limit - pos) { return false; }
+        memcpy(out + pos, src, len);
+        pos += len;
+        return true;
+    }
+
+    bool put(const char *src) {
+        return put(src, strlen(src));
+    }
+
+    // a quoted, escaped string. If cut is set a string that doesn't fit is
+    // cut short, otherwise nothing is written and false returned
+    bool put_string(const char *src, size_t len, bool cut) {
+        const size_t start = pos;
+        if (!put("\"", 1)) { return false; }
+        for (size_t i = 0; i < len; ++i) {
+            const unsigned char c = static_cast<unsigned char>(src[i]);
+            char escaped[8];
+            size_t n = 0;
+            if (c == '"' || c == '\\') {
+                escaped[n++] = '\\';
+                escaped[n++] = static_cast<char>(c);
+            } else if (c == '\n') {
+                escaped[n++] = '\\';
+                escaped[n++] = 'n';
+            } else if (c == '\t') {
+                escaped[n++] = '\\';
+                escaped[n++] = 't';
+            } else if (c == '\r') {
+                escaped[n++] = '\\';
+                escaped[n++] = 'r';
+            } else if (c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                memcpy(escaped, "\\u00", 4);
+                n = 4;
+                escaped[n++] = hex[c >> 4];
+                escaped[n++] = hex[c & 15];
+            } else {
+                escaped[n++] = static_cast<char>(c);
+            }
+            // keep room for the closing quote
+            if (n + 1 > limit - pos) {
+                if (!cut) {
+                    pos = start;
+                    return false;
+                }
+                break;
+            }
+            memcpy(out + pos, escaped, n);
+            pos += n;
+        }
+        return put("\"", 1);
+    }
+
+    bool put_value(const Args::Value &value) {
+        if (value.type == Args::Type::STRING) {
+            return put_string(value.str, value.len, false);
+        }
+        if (value.type == Args::Type::DOUBLE && !isfinite(value.as_double())) {
+            return put("null", 4);
+        }
+        char number[32];
+        char *end = Args::number_to_chars(value, number);
+        if (value.type == Args::Type::POINTER) {
+            return put_string(number, end - number, false);
+        }
+        return put(number, end - number);
+    }
+};
+
+}
+
+static const char *level_name(Level level) {
+    switch (level) {
+    case Level::DEBUG: return "DEBUG";
+    case Level::INFO: return "INFO";
+    case Level::WARNING: return "WARNING";
+    case Level::ERROR: return "ERROR";
+    case Level::CRITICAL: return "CRITICAL";
+    }
+    return "?";
+}
+
+size_t Phyber::Log::format_json(const RecordHeader &record, char *out, size_t size) {
+    // room for the closing "}\n"
+    if (size < 2) { return 0; }
+    JsonWriter w {out, size - 2};
+
+    char timefmt[TIMESTAMP_MAX];
+    size_t timefmt_len = format_timestamp(record.timestamp, timefmt);
+    char number[32];
+
+    w.put("{\"time\":");
+    w.put_string(timefmt, timefmt_len, true);
+    w.put(",\"level\":\"");
+    w.put(level_name(record.level));
+    w.put("\",\"file\":");
+    w.put_string(record.file, strlen(record.file), true);
+    w.put(",\"line\":");
+    w.put(number, std::to_chars(number, number + sizeof(number), record.line).ptr - number);
+    w.put(",\"thread\":");
+    w.put(number, std::to_chars(number, number + sizeof(number), record.thread).ptr - number);
+    w.put(",\"msg\":");
+
+    const uint8_t *payload = reinterpret_cast<const uint8_t *>(record.payload());
+    if (record.kind == RecordKind::DEFERRED) {
+        char message[PHYBER_ENGINE_LOG_MAX_MESSAGE];
+        size_t len = Args::format(record.site->format, payload, record.payload_size, message, sizeof(message));
+        w.put_string(message, len, true);
+    } else if (record.kind == RecordKind::FIELDS) {
+        w.put_string(record.site->format, strlen(record.site->format), true);
+    } else {
+        w.put_string(record.payload(), record.payload_size, true);
+    }
+
+    if (record.kind == RecordKind::FIELDS) {
+        const uint8_t *end = payload + record.payload_size;
+        Args::Value key, value;
+        while (Args::next(payload, end, key) && Args::next(payload, end, value)) {
+            // fields that don't fit are left out whole
+            const size_t start = w.pos;
+            if (!w.put(",", 1) || !w.put_string(key.str, key.len, false) || !w.put(":", 1) || !w.put_value(value)) {
+                w.pos = start;
+                break;
+            }
+        }
+    }
+
+    out[w.pos++] = '}';
+    out[w.pos++] = '\n';
+    return w.pos;
+}
@@ -0,0 +1,370 @@
+#include "phyber/log/sink.h"
+
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <limits.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace Phyber;
+using namespace Phyber::Log;
+
+static constexpr char RING_MAGIC[8] = {'P', 'H', 'Y', 'R', 'I', 'N', 'G', '\0'};
+
+static std::runtime_error error(const char *what, const char *path) {
+    return std::runtime_error(std::string("Log sink: ") + what + " (" + path + ")");
+}
+
+static uint64_t now_seconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// writes every byte of the buffers, gives up on errors other than EINTR
+static void write_all(int fd, const char *const *data, const size_t *sizes, size_t count) {
+#if defined(_WIN32)
+    for (size_t i = 0; i < count; ++i) {
+        const char *p = data[i];
+        size_t left = sizes[i];
+        while (left) {
+            int n = _write(fd, p, static_cast<unsigned int>(left < INT_MAX ? left : INT_MAX));
+            if (n <= 0) { return; }
+            p += n;
+            left -= n;
+        }
+    }
+#else
+    struct iovec iov[64];
+    size_t next = 0;
+    size_t offset = 0; // into data[next], after a partial write
+    while (next < count) {
+        int n_iov = 0;
+        for (size_t i = next; i < count && n_iov < 64; ++i, ++n_iov) {
+            iov[n_iov].iov_base = const_cast<char *>(data[i]) + (i == next ? offset : 0);
+            iov[n_iov].iov_len = sizes[i] - (i == next ? offset : 0);
+        }
+        ssize_t n = writev(fd, iov, n_iov);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return;
+        }
+        size_t written = static_cast<size_t>(n);
+        while (next < count && written >= sizes[next] - offset) {
+            written -= sizes[next] - offset;
+            offset = 0;
+            ++next;
+        }
+        offset += written;
+    }
+#endif
+}
+
+static StdoutSink &stdout_sink() {
+    // never destroyed, records may be written during static destruction
+    static StdoutSink *sink = new StdoutSink();
+    return *sink;
+}
+
+static std::atomic<Sink *> sink_override {nullptr};
+
+void Phyber::Log::set_sink(Sink *sink) {
+    sink_override.store(sink, std::memory_order_release);
+}
+
+Sink &Phyber::Log::current_sink() {
+    Sink *sink = sink_override.load(std::memory_order_acquire);
+    return sink ? *sink : stdout_sink();
+}
+
+void StdoutSink::write(const char *data, size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+#if defined(_WIN32)
+    fwrite(data, 1, size, stdout);
+    fflush(stdout);
+#else
+    // anything the program printed with stdio goes first
+    fflush(stdout);
+    write_all(STDOUT_FILENO, &data, &size, 1);
+#endif
+}
+
+void StdoutSink::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    fflush(stdout);
+}
+
+FileSink::FileSink(const char *path, const FileSinkConfig &config) : _config(config) {
+    _path = strdup(path);
+    if (!_path) { throw std::bad_alloc(); }
+    size_t count = config.buffer_size / CHUNK_SIZE;
+    if (count == 0) { count = 1; }
+    for (size_t i = 0; i < count; ++i) {
+        char *data = static_cast<char *>(malloc(CHUNK_SIZE));
+        if (!data) {
+            for (Chunk &chunk : _chunks) { free(chunk.data); }
+            free(_path);
+            throw std::bad_alloc();
+        }
+        _chunks.push_back({data, 0});
+    }
+    try {
+        open_file();
+    } catch (...) {
+        for (Chunk &chunk : _chunks) { free(chunk.data); }
+        free(_path);
+        throw;
+    }
+    _written_at = _opened_at;
+}
+
+FileSink::~FileSink() {
+    write_out();
+#if defined(_WIN32)
+    _close(_fd);
+#else
+    ::close(_fd);
+#endif
+    for (Chunk &chunk : _chunks) { free(chunk.data); }
+    free(_path);
+}
+
+void FileSink::open_file() {
+#if defined(_WIN32)
+    _fd = _open(_path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (_fd < 0) { throw error("could not open file", _path); }
+    _file_bytes = static_cast<uint64_t>(_lseeki64(_fd, 0, SEEK_END));
+#else
+    _fd = open(_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd < 0) { throw error("could not open file", _path); }
+    struct stat st;
+    _file_bytes = fstat(_fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+#endif
+    _opened_at = now_seconds();
+}
+
+// keeps logging calls from throwing, output is lost while the file can't
+// be opened
+void FileSink::try_open_file() {
+    try {
+        open_file();
+    } catch (...) {
+        _fd = -1;
+        _file_bytes = 0;
+        _opened_at = now_seconds();
+    }
+}
+
+// path -> path.1 -> path.2 ..., the oldest file is removed
+void FileSink::rotate() {
+#if defined(_WIN32)
+    _close(_fd);
+#else
+    ::close(_fd);
+#endif
+    _fd = -1;
+
+    const std::string base(_path);
+    if (_config.max_files == 0) {
+        remove(base.c_str());
+    } else {
+        remove((base + "." + std::to_string(_config.max_files)).c_str());
+        for (uint32_t i = _config.max_files; i > 1; --i) {
+            rename((base + "." + std::to_string(i - 1)).c_str(), (base + "." + std::to_string(i)).c_str());
+        }
+        rename(base.c_str(), (base + ".1").c_str());
+    }
+
+    try_open_file();
+}
+
+// before `incoming` bytes are written: retries opening a file that couldn't
+// be opened, which never rotates so failures don't eat the old files, or
+// rotates when the file would get too big or is too old
+void FileSink::prepare_file(size_t incoming) {
+    if (_fd < 0) {
+        try_open_file();
+        return;
+    }
+    const bool too_big = _config.max_bytes && _file_bytes && _file_bytes + incoming > _config.max_bytes;
+    const bool too_old = _config.max_seconds && _file_bytes && now_seconds() - _opened_at >= _config.max_seconds;
+    if (too_big || too_old) {
+        rotate();
+    }
+}
+
+void FileSink::write_out() {
+    if (_buffered == 0) { return; }
+
+    prepare_file(_buffered);
+    if (_config.flush_seconds) {
+        _written_at = now_seconds();
+    }
+
+    const char *data[64];
+    size_t sizes[64];
+    size_t count = 0;
+    for (Chunk &chunk : _chunks) {
+        if (!chunk.used) { break; }
+        data[count] = chunk.data;
+        sizes[count] = chunk.used;
+        ++count;
+        if (count == 64) {
+            if (_fd >= 0) { write_all(_fd, data, sizes, count); }
+            count = 0;
+        }
+    }
+    if (count && _fd >= 0) { write_all(_fd, data, sizes, count); }
+
+    _file_bytes += _buffered;
+    _buffered = 0;
+    for (Chunk &chunk : _chunks) { chunk.used = 0; }
+}
+
+void FileSink::write_direct(const char *data, size_t size) {
+    write_out();
+    prepare_file(size);
+    if (_fd >= 0) { write_all(_fd, &data, &size, 1); }
+    _file_bytes += size;
+}
+
+void FileSink::write(const char *data, size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (size > CHUNK_SIZE) {
+        write_direct(data, size);
+        return;
+    }
+
+    // without this, records and time based rotation would wait for the
+    // buffer to fill up
+    if (_buffered && (_config.flush_seconds || _config.max_seconds)) {
+        const uint64_t now = now_seconds();
+        if ((_config.flush_seconds && now - _written_at >= _config.flush_seconds)
+            || (_config.max_seconds && now - _opened_at >= _config.max_seconds)) {
+            write_out();
+            // the buffered records went to the old file, start a new one
+            prepare_file(0);
+        }
+    }
+
+    // chunks fill in order, the first one with room is after the last used one
+    size_t current = 0;
+    while (current + 1 < _chunks.size() && _chunks[current + 1].used) { ++current; }
+    if (CHUNK_SIZE - _chunks[current].used < size) {
+        if (current + 1 == _chunks.size()) {
+            write_out();
+            current = 0;
+        } else {
+            ++current;
+        }
+    }
+    Chunk &chunk = _chunks[current];
+    memcpy(chunk.data + chunk.used, data, size);
+    chunk.used += size;
+    _buffered += size;
+}
+
+void FileSink::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    write_out();
+}
+
+RingFileSink::RingFileSink(const char *path, size_t capacity) {
+    if (capacity == 0) { throw std::invalid_argument("Log sink: ring capacity must not be zero"); }
+    _size = sizeof(RingFileHeader) + capacity;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw error("could not open file", path);
+    }
+    const uint64_t size = _size;
+    _mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+        static_cast<DWORD>(size), NULL);
+    CloseHandle(file);
+    if (!_mapping) {
+        throw error("could not map file", path);
+    }
+    _base = MapViewOfFile(_mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (!_base) {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+        throw error("could not map file", path);
+    }
+#else
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw error("could not open file", path);
+    }
+    if (ftruncate(fd, static_cast<off_t>(_size)) != 0) {
+        ::close(fd);
+        throw error("could not resize file", path);
+    }
+    // the mapping keeps its own reference to the file
+    void *ptr = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        throw error("could not map file", path);
+    }
+    _base = ptr;
+#endif
+
+    _header = static_cast<RingFileHeader *>(_base);
+    memcpy(_header->magic, RING_MAGIC, sizeof(RING_MAGIC));
+    _header->capacity = capacity;
+    _header->written = 0;
+    memset(_header->reserved, 0, sizeof(_header->reserved));
+}
+
+RingFileSink::~RingFileSink() {
+#if defined(_WIN32)
+    FlushViewOfFile(_base, 0);
+    UnmapViewOfFile(_base);
+    CloseHandle(_mapping);
+#else
+    munmap(_base, _size);
+#endif
+}
+
+void RingFileSink::write(const char *data, size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const uint64_t capacity = _header->capacity;
+    char *ring = reinterpret_cast<char *>(_header + 1);
+    uint64_t written = _header->written;
+    // only the newest capacity bytes can survive
+    if (size > capacity) {
+        written += size - capacity;
+        data += size - capacity;
+        size = capacity;
+    }
+
+    const size_t pos = static_cast<size_t>(written % capacity);
+    const size_t first = size < capacity - pos ? size : capacity - pos;
+    memcpy(ring + pos, data, first);
+    memcpy(ring, data + first, size - first);
+    _header->written = written + size;
+}
+
+void RingFileSink::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+#if defined(_WIN32)
+    FlushViewOfFile(_base, 0);
+#else
+    msync(_base, _size, MS_ASYNC);
+#endif
+}
@@ -0,0 +1,80 @@
+#include "phyber/logging.h"
+#include "phyber/log/record.h"
+
+#include <atomic>
+#include <chrono>
+#include <string.h>
+#include <time.h>
+
+using namespace Phyber::Log;
+
+static std::atomic<TimeFormat> time_format {TimeFormat::DATE};
+
+// the formatted date of the last second seen by this thread, localtime()
+// and strftime() only run when the second changes
+struct DateCache {
+    uint64_t second = ~0ull;
+    char date[20]; // "YYYY-MM-DD HH:MM:SS"
+};
+
+static thread_local DateCache date_cache;
+
+// writes value as exactly width digits, zero padded
+static void put_digits(char *out, uint64_t value, size_t width) {
+    for (size_t i = width; i > 0; --i) {
+        out[i - 1] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+static const char *formatted_date(uint64_t second) {
+    DateCache &cache = date_cache;
+    if (cache.second != second) {
+        time_t timer = static_cast<time_t>(second);
+        struct tm tm_info;
+#if defined(_WIN32)
+        localtime_s(&tm_info, &timer);
+#else
+        localtime_r(&timer, &tm_info);
+#endif
+        strftime(cache.date, sizeof(cache.date), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cache.second = second;
+    }
+    return cache.date;
+}
+
+uint64_t Phyber::Log::timestamp_now() {
+    using namespace std::chrono;
+    // steady_clock is cheaper to read and never jumps, it is turned into
+    // wall clock time with an offset taken once
+    static const int64_t epoch_offset =
+        duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count()
+        - duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count()
+        + epoch_offset);
+}
+
+size_t Phyber::Log::format_timestamp(uint64_t timestamp, char *out) {
+    if (time_format.load(std::memory_order_relaxed) == TimeFormat::RAW) {
+        char digits[20];
+        size_t len = 0;
+        do {
+            digits[len++] = static_cast<char>('0' + timestamp % 10);
+            timestamp /= 10;
+        } while (timestamp);
+        for (size_t i = 0; i < len; ++i) {
+            out[i] = digits[len - 1 - i];
+        }
+        return len;
+    }
+
+    const char *date = formatted_date(timestamp / 1000000000ull);
+    memcpy(out, date, 19);
+    out[19] = '.';
+    put_digits(out + 20, (timestamp / 1000ull) % 1000000ull, 6);
+    return 26;
+}
+
+void Phyber::Log::set_time_format(TimeFormat format) {
+    time_format.store(format, std::memory_order_relaxed);
+}
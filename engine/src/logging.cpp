@@ -1,9 +1,12 @@
 #include "phyber/logging.h"
+#include "phyber/log/record.h"
+#include "phyber/log/sink.h"
 
+#include <atomic>
 #include <cstdarg>
 #include <stdarg.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
 
 using namespace Phyber::Log;
 
@@ -25,59 +28,199 @@ using namespace Phyber::Log;
 #define ANSI_BG_WHITE "\e[0;47m"
 #define ANSI_RESET "\e[0m"
 
-static void get_formatted_time(char buffer[26]) {
-    time_t timer;
-    struct tm* tm_info;
-
-    timer = time(NULL);
-    tm_info = localtime(&timer);
-
-    strftime(buffer, 26, "%Y-%m-%d %H:%M:%S", tm_info);
-}
-
-static void print_level(Level level) {
-    putchar('[');
+static const char *level_prefix(Level level) {
     switch (level) {
     case Level::DEBUG:
-        fputs(ANSI_BLUE, stdout);
-        fputs("DEBUG", stdout);
-        break;
+        return "[" ANSI_BLUE "DEBUG" ANSI_RESET "]";
     case Level::INFO:
-        fputs(ANSI_GREEN, stdout);
-        fputs("INFO", stdout);
-        break;
+        return "[" ANSI_GREEN "INFO" ANSI_RESET "]";
     case Level::WARNING:
-        fputs(ANSI_YELLOW, stdout);
-        fputs("WARNING", stdout);
-        break;
+        return "[" ANSI_YELLOW "WARNING" ANSI_RESET "]";
     case Level::ERROR:
-        fputs(ANSI_RED, stdout);
-        fputs("ERROR", stdout);
-        break;
+        return "[" ANSI_RED "ERROR" ANSI_RESET "]";
     case Level::CRITICAL:
-        fputs(ANSI_WHITE ANSI_BG_RED, stdout);
-        fputs("CRITICAL", stdout);
-        break;
+        return "[" ANSI_WHITE ANSI_BG_RED "CRITICAL" ANSI_RESET "]";
     }
-    fputs(ANSI_RESET, stdout);
-    putchar(']');
+    return "[?]";
 }
 
-void Phyber::Log::printf_impl(Level level, const char *file, unsigned int line, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
+// appends src to out[pos, size), returns the new position
+static size_t append(char *out, size_t pos, size_t size, const char *src, size_t len) {
+    if (pos >= size) { return pos; }
+    if (len > size - pos) { len = size - pos; }
+    memcpy(out + pos, src, len);
+    return pos + len;
+}
+
+static size_t append(char *out, size_t pos, size_t size, const char *src) {
+    return append(out, pos, size, src, strlen(src));
+}
+
+uint32_t Phyber::Log::thread_id() {
+    static std::atomic<uint32_t> next {1};
+    static thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+size_t Phyber::Log::format_text(const RecordHeader &record, char *out, size_t size) {
+    if (size == 0) { return 0; }
+    // leave room for the newline
+    const size_t limit = size - 1;
 
-    char timefmt[26];
-    get_formatted_time(timefmt);
+    char timefmt[TIMESTAMP_MAX];
+    size_t timefmt_len = format_timestamp(record.timestamp, timefmt);
+    char line[16];
+    int line_len = snprintf(line, sizeof(line), ":%u (", record.line);
 
-    print_level(level);
-    putchar(' ');
-    fputs(file, stdout);
-    printf(":%u (", line);
-    fputs(timefmt, stdout);
-    fputs(") " ANSI_PURPLE "->" ANSI_RESET " ", stdout);
-    vprintf(format, args);
-    putchar('\n');
+    size_t pos = 0;
+    pos = append(out, pos, limit, level_prefix(record.level));
+    pos = append(out, pos, limit, " ", 1);
+    pos = append(out, pos, limit, record.file);
+    pos = append(out, pos, limit, line, line_len);
+    pos = append(out, pos, limit, timefmt, timefmt_len);
+    pos = append(out, pos, limit, ") " ANSI_PURPLE "->" ANSI_RESET " ");
+    if (record.kind == RecordKind::DEFERRED) {
+        char message[PHYBER_ENGINE_LOG_MAX_MESSAGE];
+        size_t len = Args::format(record.site->format, reinterpret_cast<const uint8_t *>(record.payload()),
+            record.payload_size, message, sizeof(message));
+        pos = append(out, pos, limit, message, len);
+    } else if (record.kind == RecordKind::FIELDS) {
+        // message key=value key=value
+        pos = append(out, pos, limit, record.site->format);
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(record.payload());
+        const uint8_t *end = p + record.payload_size;
+        Args::Value key, value;
+        while (Args::next(p, end, key) && Args::next(p, end, value)) {
+            pos = append(out, pos, limit, " ", 1);
+            pos = append(out, pos, limit, key.str, key.len);
+            pos = append(out, pos, limit, "=", 1);
+            if (value.type == Args::Type::STRING) {
+                pos = append(out, pos, limit, value.str, value.len);
+            } else {
+                char number[32];
+                pos = append(out, pos, limit, number, Args::number_to_chars(value, number) - number);
+            }
+        }
+    } else {
+        pos = append(out, pos, limit, record.payload(), record.payload_size);
+    }
+    out[pos++] = '\n';
+    return pos;
+}
 
+size_t Phyber::Log::format_record(const RecordHeader &record, char *out, size_t size, Format format) {
+    if (format == Format::JSON) {
+        return format_json(record, out, size);
+    }
+    return format_text(record, out, size);
+}
+
+// formats and writes a record right away, one write per record so lines
+// from different threads don't interleave
+static void write_record(const RecordHeader &record) {
+    Sink &sink = current_sink();
+    char out[RECORD_TEXT_MAX];
+    size_t n = format_record(record, out, sizeof(out), sink.format());
+    sink.write(out, n);
+}
+
+// without async mode structured records are built here, then written
+static thread_local bool fields_sync = false;
+static thread_local uint64_t fields_buffer[(sizeof(RecordHeader) + PHYBER_ENGINE_LOG_MAX_MESSAGE) / 8];
+
+uint8_t *Phyber::Log::fields_begin(const Site &site, size_t args_size) {
+    bool dropped;
+    if (uint8_t *out = async_begin(site, RecordKind::FIELDS, args_size, dropped)) {
+        fields_sync = false;
+        return out;
+    }
+    if (dropped || args_size > PHYBER_ENGINE_LOG_MAX_MESSAGE) {
+        return nullptr;
+    }
+
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(fields_buffer);
+    record->kind = RecordKind::FIELDS;
+    record->level = site.level;
+    record->reserved = 0;
+    record->line = site.line;
+    record->file = site.file;
+    record->timestamp = timestamp_now();
+    record->thread = thread_id();
+    record->payload_size = static_cast<uint32_t>(args_size);
+    record->site = &site;
+    fields_sync = true;
+    return reinterpret_cast<uint8_t *>(record + 1);
+}
+
+void Phyber::Log::fields_commit(size_t args_size) {
+    if (!fields_sync) {
+        async_commit(args_size);
+        return;
+    }
+    write_record(*reinterpret_cast<const RecordHeader *>(fields_buffer));
+}
+
+void Phyber::Log::log_text(const Site &site, const char *message, size_t len) {
+    if (len > PHYBER_ENGINE_LOG_MAX_MESSAGE) { len = PHYBER_ENGINE_LOG_MAX_MESSAGE; }
+    if (flight_mode.load(std::memory_order_relaxed)) {
+        flight_text(site, message, len);
+        if (site.state.load(std::memory_order_relaxed) == SiteState::RECORDED) { return; }
+    }
+    bool dropped;
+    if (uint8_t *out = async_begin(site, RecordKind::TEXT, len, dropped)) {
+        memcpy(out, message, len);
+        async_commit(len);
+        return;
+    }
+    if (dropped) { return; }
+
+    struct {
+        RecordHeader header;
+        char message[PHYBER_ENGINE_LOG_MAX_MESSAGE];
+    } record;
+    memcpy(record.message, message, len);
+    record.header.kind = RecordKind::TEXT;
+    record.header.level = site.level;
+    record.header.reserved = 0;
+    record.header.line = site.line;
+    record.header.file = site.file;
+    record.header.timestamp = timestamp_now();
+    record.header.thread = thread_id();
+    record.header.payload_size = static_cast<uint32_t>(len);
+    record.header.site = nullptr;
+    write_record(record.header);
+}
+
+void Phyber::Log::vprintf_impl(Level level, const char *file, unsigned int line, const char *format, va_list args) {
+    if (async_vlog(level, file, line, format, args)) {
+        return;
+    }
+
+    // header and message back to back, the same layout as a queued record
+    struct {
+        RecordHeader header;
+        char message[PHYBER_ENGINE_LOG_MAX_MESSAGE];
+    } record;
+
+    int len = vsnprintf(record.message, sizeof(record.message), format, args);
+    if (len < 0) { len = 0; }
+    if (static_cast<size_t>(len) >= sizeof(record.message)) { len = sizeof(record.message) - 1; }
+
+    record.header.kind = RecordKind::TEXT;
+    record.header.level = level;
+    record.header.reserved = 0;
+    record.header.line = line;
+    record.header.file = file;
+    record.header.timestamp = timestamp_now();
+    record.header.thread = thread_id();
+    record.header.payload_size = static_cast<uint32_t>(len);
+    record.header.site = nullptr;
+    write_record(record.header);
+}
+
+void Phyber::Log::printf_impl(Level level, const char *file, unsigned int line, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf_impl(level, file, line, format, args);
     va_end(args);
 }
@@ -0,0 +1,201 @@
+#include "phyber/utils/memory.h"
+
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Phyber::Memory;
+
+static std::atomic<size_t> reserved_total {0};
+static std::atomic<size_t> committed_total {0};
+
+static size_t round_up(size_t v, size_t multiple) {
+    return (v + multiple - 1) / multiple * multiple;
+}
+
+size_t Phyber::Memory::page_size() {
+    static const size_t size = [] {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }();
+    return size;
+}
+
+Stats Phyber::Memory::get_stats() {
+    return Stats {
+        reserved_total.load(std::memory_order_relaxed),
+        committed_total.load(std::memory_order_relaxed)
+    };
+}
+
+VirtualBuffer::VirtualBuffer(VirtualBuffer &&other) noexcept
+    : _base(other._base), _reserved(other._reserved), _committed(other._committed) {
+    other._base = nullptr;
+    other._reserved = 0;
+    other._committed = 0;
+}
+
+VirtualBuffer &VirtualBuffer::operator=(VirtualBuffer &&other) noexcept {
+    if (this != &other) {
+        release();
+        _base = other._base;
+        _reserved = other._reserved;
+        _committed = other._committed;
+        other._base = nullptr;
+        other._reserved = 0;
+        other._committed = 0;
+    }
+    return *this;
+}
+
+void VirtualBuffer::reserve(size_t max_bytes) {
+    release();
+    if (max_bytes == 0) { return; }
+
+    size_t size = round_up(max_bytes, page_size());
+
+#if defined(_WIN32)
+    void *ptr = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    _base = static_cast<uint8_t *>(ptr);
+#else
+    // over-reserve so the start can be aligned to a huge page, then give
+    // back the unaligned head and tail
+    const bool huge = size >= PHYBER_ENGINE_HUGE_PAGE_SIZE;
+    if (huge) {
+        size = round_up(size, PHYBER_ENGINE_HUGE_PAGE_SIZE);
+    }
+    const size_t slack = huge ? PHYBER_ENGINE_HUGE_PAGE_SIZE : 0;
+
+    void *ptr = mmap(NULL, size + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    uint8_t *raw = static_cast<uint8_t *>(ptr);
+    uint8_t *aligned = raw;
+    if (huge) {
+        aligned = reinterpret_cast<uint8_t *>(round_up(reinterpret_cast<uintptr_t>(raw), PHYBER_ENGINE_HUGE_PAGE_SIZE));
+        if (aligned != raw) {
+            munmap(raw, aligned - raw);
+        }
+        size_t tail = (raw + size + slack) - (aligned + size);
+        if (tail) {
+            munmap(aligned + size, tail);
+        }
+#if defined(MADV_HUGEPAGE)
+        // only a hint, THP may be disabled system wide
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    }
+    _base = aligned;
+#endif
+
+    _reserved = size;
+    _committed = 0;
+    reserved_total.fetch_add(size, std::memory_order_relaxed);
+}
+
+void VirtualBuffer::commit(size_t bytes) {
+    if (bytes > _reserved) {
+        throw std::out_of_range("Commit exceeds reserved size");
+    }
+    size_t new_committed = round_up(bytes, page_size());
+    if (new_committed <= _committed) { return; }
+
+#if defined(_WIN32)
+    if (!VirtualAlloc(_base + _committed, new_committed - _committed, MEM_COMMIT, PAGE_READWRITE)) {
+        throw std::bad_alloc();
+    }
+#else
+    if (mprotect(_base + _committed, new_committed - _committed, PROT_READ | PROT_WRITE) != 0) {
+        throw std::bad_alloc();
+    }
+#endif
+
+    committed_total.fetch_add(new_committed - _committed, std::memory_order_relaxed);
+    _committed = new_committed;
+}
+
+void VirtualBuffer::decommit(size_t bytes) {
+    size_t new_committed = round_up(bytes, page_size());
+    if (new_committed >= _committed) { return; }
+
+    uint8_t *start = _base + new_committed;
+    size_t length = _committed - new_committed;
+#if defined(_WIN32)
+    VirtualFree(start, length, MEM_DECOMMIT);
+#else
+    madvise(start, length, MADV_DONTNEED);
+    mprotect(start, length, PROT_NONE);
+#endif
+
+    committed_total.fetch_sub(length, std::memory_order_relaxed);
+    _committed = new_committed;
+}
+
+void VirtualBuffer::release() {
+    if (!_base) { return; }
+
+#if defined(_WIN32)
+    VirtualFree(_base, 0, MEM_RELEASE);
+#else
+    munmap(_base, _reserved);
+#endif
+
+    reserved_total.fetch_sub(_reserved, std::memory_order_relaxed);
+    committed_total.fetch_sub(_committed, std::memory_order_relaxed);
+    _base = nullptr;
+    _reserved = 0;
+    _committed = 0;
+}
+
+size_t VirtualBuffer::huge_page_bytes() const {
+#if defined(__linux__)
+    if (!_base || _committed == 0) { return 0; }
+
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) { return 0; }
+
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(_base);
+    const uintptr_t end = begin + _committed;
+    bool in_range = false;
+    size_t total_kb = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long vma_start, vma_end;
+        // mapping headers look like "7f12a0000000-7f12a0200000 rw-p ..."
+        if (sscanf(line, "%llx-%llx ", &vma_start, &vma_end) == 2) {
+            in_range = vma_start < end && vma_end > begin;
+            continue;
+        }
+        size_t kb;
+        if (in_range && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            total_kb += kb;
+        }
+    }
+    fclose(f);
+
+    size_t bytes = total_kb * 1024;
+    return bytes < _committed ? bytes : _committed;
+#else
+    return 0;
+#endif
+}
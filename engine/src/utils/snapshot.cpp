@@ -0,0 +1,232 @@
+#include "phyber/utils/snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Phyber::Snapshot;
+
+static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+
+static uint64_t rotl(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static uint64_t read_u64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t mix(uint64_t acc, uint64_t word) {
+    return rotl(acc + word * PRIME2, 31) * PRIME1;
+}
+
+static std::runtime_error error(const char *what, const char *path) {
+    return std::runtime_error(std::string("Snapshot: ") + what + " (" + path + ")");
+}
+
+// four independent lanes so the multiplies pipeline, folded at the end
+uint64_t Phyber::Snapshot::checksum(const void *data, size_t size) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    const uint8_t *end = p + size;
+    uint64_t lanes[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+
+    while (end - p >= 32) {
+        lanes[0] = mix(lanes[0], read_u64(p));
+        lanes[1] = mix(lanes[1], read_u64(p + 8));
+        lanes[2] = mix(lanes[2], read_u64(p + 16));
+        lanes[3] = mix(lanes[3], read_u64(p + 24));
+        p += 32;
+    }
+
+    uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    h += size;
+    while (end - p >= 8) {
+        h = rotl(h ^ mix(0, read_u64(p)), 27) * PRIME1 + PRIME3;
+        p += 8;
+    }
+    while (p < end) {
+        h = rotl(h ^ (*p * PRIME3), 11) * PRIME1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+void Phyber::Snapshot::write(const char *path, const void *data, size_t count, size_t element_size, size_t element_align) {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    // elements start at the first multiple of their alignment past the header
+    size_t align = element_align > sizeof(Header) ? element_align : sizeof(Header);
+    header.data_offset = static_cast<uint32_t>((sizeof(Header) + align - 1) / align * align);
+    header.element_size = element_size;
+    header.element_align = element_align;
+    header.count = count;
+    header.checksum = checksum(data, count * element_size);
+
+    std::string tmp_path = std::string(path) + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f) {
+        throw error("could not open file for writing", tmp_path.c_str());
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    static const uint8_t zeros[256] = {};
+    for (size_t pad = header.data_offset - sizeof(header); ok && pad > 0; ) {
+        size_t n = pad < sizeof(zeros) ? pad : sizeof(zeros);
+        ok = fwrite(zeros, 1, n, f) == n;
+        pad -= n;
+    }
+    if (ok && count) {
+        ok = fwrite(data, element_size, count, f) == count;
+    }
+    ok = fclose(f) == 0 && ok;
+
+    if (!ok) {
+        remove(tmp_path.c_str());
+        throw error("write failed", tmp_path.c_str());
+    }
+#if defined(_WIN32)
+    if (!MoveFileExA(tmp_path.c_str(), path, MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (rename(tmp_path.c_str(), path) != 0) {
+#endif
+        remove(tmp_path.c_str());
+        throw error("could not replace file", path);
+    }
+}
+
+MappedFile::MappedFile(const char *path, size_t element_size, size_t element_align, bool verify_checksum) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw error("could not open file", path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(Header)) {
+        CloseHandle(file);
+        throw error("file too small", path);
+    }
+    _size = static_cast<size_t>(file_size.QuadPart);
+    _mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!_mapping) {
+        throw error("could not map file", path);
+    }
+    _base = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!_base) {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+        throw error("could not map file", path);
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        throw error("could not open file", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        ::close(fd);
+        throw error("file too small", path);
+    }
+    _size = static_cast<size_t>(st.st_size);
+    // the mapping keeps its own reference to the file
+    void *ptr = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        throw error("could not map file", path);
+    }
+    _base = ptr;
+#endif
+
+    _header = static_cast<const Header *>(_base);
+    const char *problem = nullptr;
+    if (memcmp(_header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        problem = "not a snapshot file";
+    } else if (_header->version != VERSION) {
+        problem = "unsupported version";
+    } else if (_header->element_size != element_size || _header->element_align != element_align) {
+        problem = "element layout mismatch";
+    } else if (_header->data_offset < sizeof(Header) || _header->data_offset % element_align != 0 ||
+               _header->data_offset > _size ||
+               _header->count > (_size - _header->data_offset) / element_size) {
+        problem = "truncated or corrupt file";
+    } else if (verify_checksum && !verify()) {
+        problem = "checksum mismatch";
+    }
+    if (problem) {
+        close();
+        throw error(problem, path);
+    }
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : _base(other._base), _size(other._size),
+#if defined(_WIN32)
+      _mapping(other._mapping),
+#endif
+      _header(other._header) {
+    other._base = nullptr;
+    other._size = 0;
+#if defined(_WIN32)
+    other._mapping = nullptr;
+#endif
+    other._header = nullptr;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        _base = other._base;
+        _size = other._size;
+#if defined(_WIN32)
+        _mapping = other._mapping;
+        other._mapping = nullptr;
+#endif
+        _header = other._header;
+        other._base = nullptr;
+        other._size = 0;
+        other._header = nullptr;
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+    if (!_base) { return; }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(_base);
+    CloseHandle(_mapping);
+    _mapping = nullptr;
+#else
+    munmap(_base, _size);
+#endif
+
+    _base = nullptr;
+    _size = 0;
+    _header = nullptr;
+}
+
+bool MappedFile::verify() const {
+    if (!_header) { return false; }
+    return checksum(data(), _header->count * _header->element_size) == _header->checksum;
+}
@@ -0,0 +1,113 @@
+#include "phyber/utils/string_id.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "phyber/utils/datatypes.h"
+
+using namespace Phyber;
+
+// interned strings are copied into blocks of this size and never freed,
+// so the pointers handed out by lookup() stay valid
+static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+namespace {
+
+struct Interner {
+    std::shared_mutex mutex;
+    FlatHashMap<uint64_t, const char *> strings;
+    DynamicArray<char *> blocks; // every allocation, big strings included
+    char *current_block = nullptr; // where small strings go
+    size_t block_used = BLOCK_SIZE;
+
+    const char *store(std::string_view str) {
+        size_t size = str.size() + 1;
+        char *dst;
+        if (size > BLOCK_SIZE / 4) {
+            // big strings get their own allocation instead of wasting a block
+            dst = static_cast<char *>(malloc(size));
+            if (!dst) { throw std::bad_alloc(); }
+            blocks.push_back(dst);
+        } else {
+            if (block_used + size > BLOCK_SIZE) {
+                char *block = static_cast<char *>(malloc(BLOCK_SIZE));
+                if (!block) { throw std::bad_alloc(); }
+                blocks.push_back(block);
+                current_block = block;
+                block_used = 0;
+            }
+            dst = current_block + block_used;
+            block_used += size;
+        }
+        memcpy(dst, str.data(), str.size());
+        dst[str.size()] = '\0';
+        return dst;
+    }
+};
+
+}
+
+// never destroyed, ids may still be printed from static destructors
+static Interner &interner() {
+    static Interner *instance = new Interner();
+    return *instance;
+}
+
+static void check_collision(const char *existing, std::string_view str, uint64_t hash) {
+#if PHYBER_ENGINE_STRING_ID_CHECK_COLLISIONS
+    if (std::string_view(existing) != str) {
+        throw std::logic_error("StringId collision: \"" + std::string(str) + "\" and \"" + existing
+            + "\" both hash to " + std::to_string(hash));
+    }
+#else
+    (void)existing;
+    (void)str;
+    (void)hash;
+#endif
+}
+
+uint64_t Phyber::StringIdUtils::intern(std::string_view str) {
+    const uint64_t hash = fnv1a(str.data(), str.size());
+    Interner &in = interner();
+
+    {
+        std::shared_lock<std::shared_mutex> lock(in.mutex);
+        auto it = in.strings.find(hash);
+        if (it != in.strings.end()) {
+            check_collision(it->second, str, hash);
+            return hash;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(in.mutex);
+    // another thread may have won the race since the shared lock was dropped
+    auto it = in.strings.find(hash);
+    if (it != in.strings.end()) {
+        check_collision(it->second, str, hash);
+        return hash;
+    }
+    in.strings.insert(hash, in.store(str));
+    return hash;
+}
+
+const char *Phyber::StringIdUtils::lookup(uint64_t hash) {
+    Interner &in = interner();
+    std::shared_lock<std::shared_mutex> lock(in.mutex);
+    auto it = in.strings.find(hash);
+    return it != in.strings.end() ? it->second : nullptr;
+}
+
+size_t Phyber::StringIdUtils::interned_count() {
+    Interner &in = interner();
+    std::shared_lock<std::shared_mutex> lock(in.mutex);
+    return in.strings.size();
+}
+
+const char *StringId::str() const {
+    const char *s = StringIdUtils::lookup(_hash);
+    return s ? s : "<unknown>";
+}
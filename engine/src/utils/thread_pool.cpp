@@ -0,0 +1,113 @@
+#include "phyber/utils/thread_pool.h"
+
+using namespace Phyber;
+
+// set on pool workers and on callers while they help with a batch, so
+// nested run() calls execute inline instead of deadlocking
+static thread_local bool inside_pool = false;
+
+ThreadPool::ThreadPool(unsigned int n_workers) {
+    if (n_workers == 0) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        n_workers = hw > 1 ? hw - 1 : 0;
+    }
+    _workers.reserve(n_workers);
+    for (unsigned int i = 0; i < n_workers; ++i) {
+        _workers.push_back(std::thread([this] { worker_loop(); }));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread &worker : _workers) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::global() {
+    static ThreadPool pool(PHYBER_ENGINE_WORKER_THREADS);
+    return pool;
+}
+
+void ThreadPool::execute(const Job &job) {
+    size_t i;
+    while ((i = _next.fetch_add(1, std::memory_order_relaxed)) < job.n_tasks) {
+        try {
+            job.fn(job.ctx, i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::worker_loop() {
+    inside_pool = true;
+    uint64_t seen = 0;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wake.wait(lock, [&] { return _stop || _generation != seen; });
+        if (_stop) { return; }
+
+        seen = _generation;
+        Job job = _job;
+        ++_active;
+        lock.unlock();
+
+        execute(job);
+
+        lock.lock();
+        if (--_active == 0) {
+            _finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::run_job(const Job &job) {
+    if (job.n_tasks == 1 || _workers.size() == 0 || inside_pool) {
+        for (size_t i = 0; i < job.n_tasks; ++i) {
+            job.fn(job.ctx, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        // workers still holding the previous job must let go of it before
+        // _next is reset, or they could run its (dead) task with new indices
+        _finished.wait(lock, [&] { return _active == 0; });
+        _job = job;
+        _error = nullptr;
+        _next.store(0, std::memory_order_relaxed);
+        _remaining.store(job.n_tasks, std::memory_order_relaxed);
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    inside_pool = true;
+    execute(job);
+    inside_pool = false;
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finished.wait(lock, [&] { return _remaining.load(std::memory_order_acquire) == 0; });
+        error = _error;
+        _error = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,261 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+#include "phyber/utils/datatypes.h"
+#include "phyber/utils/parallel.h"
+#include "phyber/utils/radix_sort.h"
+#include "phyber/utils/thread_pool.h"
+
+template <typename T>
+static bool is_sorted(Phyber::DynamicArray<T> &arr) {
+    return std::is_sorted(arr.begin(), arr.end());
+}
+
+TEST_CASE("RadixSort", "[RadixSort]") {
+    std::mt19937_64 rng(1234);
+
+    SECTION("unsigned 32 bit keys") {
+        Phyber::DynamicArray<uint32_t> keys;
+        for (int i = 0; i < 10000; ++i) {
+            keys.push_back(static_cast<uint32_t>(rng()));
+        }
+
+        Phyber::RadixSort::sort(keys);
+        CHECK(keys.size() == 10000);
+        CHECK(is_sorted(keys));
+    }
+
+    SECTION("signed 16 and 64 bit keys") {
+        Phyber::DynamicArray<int16_t> small;
+        Phyber::DynamicArray<int64_t> big;
+        for (int i = 0; i < 5000; ++i) {
+            small.push_back(static_cast<int16_t>(rng()));
+            big.push_back(static_cast<int64_t>(rng()));
+        }
+
+        Phyber::RadixSort::sort(small);
+        Phyber::RadixSort::sort(big);
+        CHECK(is_sorted(small));
+        CHECK(is_sorted(big));
+    }
+
+    SECTION("float keys with negatives") {
+        std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+        Phyber::DynamicArray<float> keys;
+        for (int i = 0; i < 5000; ++i) {
+            keys.push_back(dist(rng));
+        }
+        keys.push_back(-0.0f);
+        keys.push_back(0.0f);
+
+        Phyber::RadixSort::sort(keys);
+        CHECK(is_sorted(keys));
+    }
+
+    SECTION("pairs are moved with their keys and the sort is stable") {
+        Phyber::DynamicArray<uint32_t> keys;
+        Phyber::DynamicArray<uint32_t> values;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            keys.push_back(i % 10);
+            values.push_back(i);
+        }
+
+        Phyber::RadixSort::sort_pairs(keys, values);
+        CHECK(is_sorted(keys));
+        CHECK(is_sorted(values) == false);
+        bool ok = true;
+        for (size_t i = 0; i < 1000; ++i) {
+            ok &= values[i] % 10 == keys[i];
+            if (i > 0 && keys[i] == keys[i - 1]) {
+                ok &= values[i] > values[i - 1];
+            }
+        }
+        CHECK(ok);
+    }
+
+    SECTION("sort_indices leaves keys untouched") {
+        Phyber::DynamicArray<float> z;
+        z.push_back(3.0f);
+        z.push_back(-1.0f);
+        z.push_back(2.0f);
+
+        Phyber::DynamicArray<uint32_t> order;
+        Phyber::RadixSort::sort_indices(z, order);
+
+        CHECK(order.size() == 3);
+        CHECK(order[0] == 1);
+        CHECK(order[1] == 2);
+        CHECK(order[2] == 0);
+        CHECK(z[0] == 3.0f);
+    }
+
+    SECTION("scratch space is reused") {
+        Phyber::DynamicArray<uint64_t> keys, scratch;
+        for (int i = 0; i < 100; ++i) {
+            keys.push_back(rng());
+        }
+
+        Phyber::RadixSort::sort(keys, &scratch);
+        CHECK(scratch.size() >= 100);
+        CHECK(is_sorted(keys));
+    }
+
+    SECTION("parallel sort matches serial sort") {
+        Phyber::DynamicArray<int32_t> a, b;
+        for (int i = 0; i < 200000; ++i) {
+            int32_t v = static_cast<int32_t>(rng());
+            a.push_back(v);
+            b.push_back(v);
+        }
+
+        Phyber::RadixSort::sort(a);
+        Phyber::RadixSort::parallel_sort(b, nullptr, 4);
+        CHECK(std::equal(a.begin(), a.end(), b.begin()));
+    }
+
+    SECTION("more keys than the 32 bit counters can hold are rejected") {
+        if constexpr (sizeof(size_t) > sizeof(uint32_t)) {
+            // the size is checked before any key is read
+            const size_t n = size_t(UINT32_MAX) + 1;
+            uint32_t keys[2] = {2, 1}, scratch[2];
+            CHECK_THROWS_AS(Phyber::RadixSort::sort(keys, n, scratch), std::length_error);
+            CHECK(keys[0] == 2);
+        }
+    }
+}
+
+TEST_CASE("ThreadPool", "[ThreadPool]") {
+    Phyber::ThreadPool pool(3);
+    CHECK(pool.worker_count() == 3);
+    CHECK(pool.concurrency() == 4);
+
+    SECTION("every task runs exactly once") {
+        Phyber::DynamicArray<int> hits;
+        hits.resize(1000);
+        for (int round = 0; round < 20; ++round) {
+            pool.run(hits.size(), [&](size_t i) { ++hits[i]; });
+        }
+        CHECK(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 20; }));
+    }
+
+    SECTION("nested batches run inline") {
+        std::atomic<int> total {0};
+        pool.run(8, [&](size_t) {
+            pool.run(8, [&](size_t) { total.fetch_add(1); });
+        });
+        CHECK(total.load() == 64);
+    }
+
+    SECTION("exceptions reach the caller") {
+        CHECK_THROWS_AS(pool.run(100, [](size_t i) {
+            if (i == 42) { throw std::runtime_error("task failed"); }
+        }), std::runtime_error);
+
+        // the pool is still usable afterwards
+        std::atomic<int> total {0};
+        pool.run(10, [&](size_t) { total.fetch_add(1); });
+        CHECK(total.load() == 10);
+    }
+}
+
+TEST_CASE("Parallel algorithms", "[Parallel]") {
+    Phyber::DynamicArray<int64_t> data;
+    for (int64_t i = 0; i < 100000; ++i) {
+        data.push_back(i % 1000 - 500);
+    }
+
+    SECTION("parallel_for visits every element once") {
+        Phyber::parallel_for(data, [](int64_t &v) { v *= 2; }, 256);
+        bool ok = true;
+        for (int64_t i = 0; i < 100000; ++i) {
+            ok &= data[i] == (i % 1000 - 500) * 2;
+        }
+        CHECK(ok);
+
+        std::atomic<size_t> count {0};
+        Phyber::parallel_for(size_t(5000), [&](size_t) { count.fetch_add(1); }, 100);
+        CHECK(count.load() == 5000);
+    }
+
+    SECTION("chunks start on cache lines") {
+        const int64_t *base = data.begin() + 3;
+        Phyber::ParallelUtils::Chunking c = Phyber::ParallelUtils::make_chunking(base, 99997, 1000, 4);
+        CHECK(c.count > 1);
+        CHECK(c.end(c.count - 1) == 99997);
+        bool ok = true;
+        for (size_t k = 1; k < c.count; ++k) {
+            ok &= c.begin(k) == c.end(k - 1);
+            ok &= reinterpret_cast<uintptr_t>(base + c.begin(k)) % PHYBER_ENGINE_CACHE_LINE_SIZE == 0;
+        }
+        CHECK(ok);
+    }
+
+    SECTION("parallel_transform") {
+        Phyber::DynamicArray<double> out;
+        Phyber::parallel_transform(data, out, [](int64_t v) { return v * 0.5; }, 512);
+        CHECK(out.size() == data.size());
+        bool ok = true;
+        for (size_t i = 0; i < data.size(); ++i) {
+            ok &= out[i] == data[i] * 0.5;
+        }
+        CHECK(ok);
+
+        Phyber::DynamicArray<double> small;
+        small.resize(3);
+        CHECK_THROWS_AS(Phyber::parallel_transform(std::span<const int64_t>(data.begin(), data.size()),
+            std::span<double>(small.begin(), small.size()), [](int64_t v) { return double(v); }), std::invalid_argument);
+    }
+
+    SECTION("parallel_reduce keeps the order of a non-commutative op") {
+        int64_t expected = 0;
+        for (int64_t v : data) { expected += v; }
+        CHECK(Phyber::parallel_reduce(data, int64_t(7), std::plus<>(), 300) == expected + 7);
+
+        Phyber::DynamicArray<int> digits;
+        for (int i = 0; i < 5000; ++i) { digits.push_back(i % 10); }
+        // appending (value, digit count) pairs is associative but not commutative
+        auto concat = [](std::pair<int64_t, int64_t> a, std::pair<int64_t, int64_t> b) {
+            int64_t shift = 1;
+            for (int64_t i = 0; i < b.second; ++i) { shift = shift * 10 % 1000003; }
+            return std::pair<int64_t, int64_t>((a.first * shift + b.first) % 1000003, a.second + b.second);
+        };
+        Phyber::DynamicArray<std::pair<int64_t, int64_t>> pairs;
+        for (int d : digits) { pairs.push_back({d, 1}); }
+        std::pair<int64_t, int64_t> serial {0, 0};
+        for (const auto &p : pairs) { serial = concat(serial, p); }
+        CHECK(Phyber::parallel_reduce(pairs, std::pair<int64_t, int64_t>(0, 0), concat, 64) == serial);
+    }
+
+    SECTION("parallel_scan") {
+        Phyber::DynamicArray<int64_t> out;
+        Phyber::parallel_scan(data, out, std::plus<>(), 333);
+        int64_t acc = 0;
+        bool ok = out.size() == data.size();
+        for (size_t i = 0; i < data.size(); ++i) {
+            acc += data[i];
+            ok &= out[i] == acc;
+        }
+        CHECK(ok);
+
+        // in place
+        Phyber::parallel_scan(data, data, std::plus<>(), 333);
+        CHECK(std::equal(data.begin(), data.end(), out.begin()));
+    }
+
+    SECTION("small ranges run inline") {
+        Phyber::DynamicArray<int> few;
+        few.push_back(1);
+        few.push_back(2);
+        CHECK(Phyber::parallel_reduce(few, 0) == 3);
+        Phyber::DynamicArray<int> empty;
+        CHECK(Phyber::parallel_reduce(empty, 5) == 5);
+        Phyber::parallel_scan(empty, empty);
+        CHECK(empty.size() == 0);
+    }
+}
@@ -0,0 +1,360 @@
+#include "phyber/utils/datatypes.h"
+
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// compares DynamicArray against std::vector. Prints one JSON object per line
+// so results can be diffed between builds:
+//   time_ns   best wall time of REPEATS runs, setup such as filling the
+//             container before erasing from it is not timed
+//   ops       operations in the timed part, ns_per_op = time_ns / ops
+//   grows     number of times the capacity changed (one allocator call each)
+//   news      calls to global operator new, element allocations included.
+//             DynamicArray stores trivial types with malloc/realloc, which
+//             only show up in grows
+//   note      set when the two sides can't do exactly the same thing
+// usage: phyber_engine_container_bench [scale] [--baseline file] [--tolerance percent]
+// With --baseline, every result is compared to the line with the same
+// container, type, op and n in a file saved from an earlier run. If any
+// ns_per_op is more than tolerance percent (default 25) slower the
+// regressions are listed on stderr and the exit code is 1
+
+using namespace Phyber;
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static size_t new_calls = 0;
+
+void *operator new(size_t size) {
+    ++new_calls;
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    ++new_calls;
+    size_t a = static_cast<size_t>(align);
+    if (void *p = aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+static constexpr int REPEATS = 5;
+
+// non-trivial but allocation free (the name fits in the small string buffer)
+struct Entity {
+    std::string name;
+    float x = 0, y = 0, z = 0;
+
+    Entity() {}
+    explicit Entity(uint64_t i) : name("entity"), x(float(i)), y(1), z(2) {}
+};
+
+static uint64_t make(uint64_t i, uint64_t *) { return i; }
+static Entity make(uint64_t i, Entity *) { return Entity(i); }
+
+static uint64_t value_of(uint64_t v) { return v; }
+static uint64_t value_of(const Entity &e) { return uint64_t(e.x); }
+
+// uniform access to both containers
+template <typename T>
+static void insert_at(DynamicArray<T> &c, size_t pos, const T &v) { c.insert(pos, v); }
+template <typename T>
+static void insert_at(std::vector<T> &c, size_t pos, const T &v) { c.insert(c.begin() + pos, v); }
+template <typename T>
+static void erase_at(DynamicArray<T> &c, size_t pos) { c.erase(pos); }
+template <typename T>
+static void erase_at(std::vector<T> &c, size_t pos) { c.erase(c.begin() + pos); }
+// DynamicArray::reserve() sets the capacity exactly and drops the elements
+// that don't fit, vector::reserve() never shrinks. The vector side gets
+// there with resize + shrink_to_fit + reserve, which can reallocate twice
+template <typename T>
+static void set_capacity(DynamicArray<T> &c, size_t capacity) { c.reserve(capacity); }
+template <typename T>
+static void set_capacity(std::vector<T> &c, size_t capacity) {
+    if (capacity < c.capacity()) {
+        if (capacity < c.size()) {
+            c.resize(capacity);
+        }
+        c.shrink_to_fit();
+    }
+    c.reserve(capacity);
+}
+
+struct Counts {
+    size_t grows = 0;
+    size_t news = 0;
+    size_t news_start = 0; // ops that prefill move this past their setup
+};
+
+// the timed part of an op, everything before start() is setup
+struct Timer {
+    bench_clock_t::time_point begin;
+    double ns = 0;
+
+    void start() { begin = bench_clock_t::now(); }
+    void stop() { ns = std::chrono::duration<double, std::nano>(bench_clock_t::now() - begin).count(); }
+};
+
+// capacity changes are only tracked on the first, untimed run
+template <typename C>
+struct Tracker {
+    const C &c;
+    Counts *counts;
+    size_t last;
+
+    Tracker(const C &container, Counts *out) : c(container), counts(out), last(container.capacity()) {}
+    void check() {
+        if (counts && c.capacity() != last) {
+            ++counts->grows;
+            last = c.capacity();
+        }
+    }
+};
+
+static volatile uint64_t sink;
+
+// every op returns the number of operations it timed
+template <typename C, typename T>
+static size_t op_push_back(size_t n, Counts *counts, Timer &timer) {
+    C c;
+    Tracker<C> t(c, counts);
+    timer.start();
+    for (size_t i = 0; i < n; ++i) {
+        c.push_back(make(i, (T *)nullptr));
+        t.check();
+    }
+    timer.stop();
+    sink = c.size();
+    return n;
+}
+
+// where: 0 front, 1 middle, 2 end
+template <typename C, typename T, int Where>
+static size_t op_insert(size_t n, Counts *counts, Timer &timer) {
+    C c;
+    Tracker<C> t(c, counts);
+    timer.start();
+    for (size_t i = 0; i < n; ++i) {
+        size_t pos = Where == 0 ? 0 : (Where == 1 ? c.size() / 2 : c.size());
+        insert_at(c, pos, make(i, (T *)nullptr));
+        t.check();
+    }
+    timer.stop();
+    sink = c.size();
+    return n;
+}
+
+template <typename C, typename T>
+static size_t op_erase(size_t n, Counts *counts, Timer &timer) {
+    C c;
+    for (size_t i = 0; i < n; ++i) {
+        c.push_back(make(i, (T *)nullptr));
+    }
+    if (counts) { counts->news_start = new_calls; }
+    Tracker<C> t(c, counts);
+    timer.start();
+    while (c.size() > 0) {
+        erase_at(c, c.size() / 2);
+        t.check();
+    }
+    timer.stop();
+    sink = c.size();
+    return n;
+}
+
+// Resize: 0 sets the capacity to random targets, 1 resizes to them
+template <typename C, typename T, int Resize>
+static size_t op_churn(size_t n, Counts *counts, Timer &timer) {
+    constexpr size_t STEPS = 1000;
+    C c;
+    Tracker<C> t(c, counts);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    timer.start();
+    for (size_t i = 0; i < STEPS; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t target = state % n;
+        if (Resize) {
+            c.resize(target);
+        } else {
+            set_capacity(c, target);
+        }
+        t.check();
+    }
+    timer.stop();
+    sink = c.size();
+    return STEPS;
+}
+
+template <typename C, typename T>
+static size_t op_iterate(size_t n, Counts *counts, Timer &timer) {
+    constexpr size_t PASSES = 10;
+    C c;
+    for (size_t i = 0; i < n; ++i) {
+        c.push_back(make(i, (T *)nullptr));
+    }
+    if (counts) { counts->news_start = new_calls; }
+    uint64_t sum = 0;
+    timer.start();
+    for (size_t pass = 0; pass < PASSES; ++pass) {
+        for (const T &v : c) {
+            sum += value_of(v);
+        }
+    }
+    timer.stop();
+    sink = sum;
+    return n * PASSES;
+}
+
+typedef size_t (*op_fn)(size_t, Counts *, Timer &);
+
+// results of an earlier run and the allowed slowdown, see usage above
+struct Gate {
+    std::vector<std::pair<std::string, double>> baseline; // result key, ns_per_op
+    double tolerance = 0.25;
+    int regressions = 0;
+};
+
+static std::string result_key(const char *container, const char *type, const char *op, size_t n) {
+    return std::string(container) + "/" + type + "/" + op + "/" + std::to_string(n);
+}
+
+// the text after "key": up to the next , or }, quotes stripped. Only meant
+// for the lines this program prints
+static std::string json_field(const char *line, const char *key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    const char *p = strstr(line, pattern.c_str());
+    if (!p) { return ""; }
+    p += pattern.size();
+    std::string value;
+    for (; *p && *p != ',' && *p != '}' && *p != '\n'; ++p) {
+        if (*p != '"') { value += *p; }
+    }
+    return value;
+}
+
+static bool load_baseline(Gate &gate, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) { return false; }
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        std::string ns_per_op = json_field(line, "ns_per_op");
+        if (ns_per_op.empty()) { continue; }
+        gate.baseline.emplace_back(result_key(json_field(line, "container").c_str(), json_field(line, "type").c_str(),
+            json_field(line, "op").c_str(), strtoull(json_field(line, "n").c_str(), nullptr, 10)), atof(ns_per_op.c_str()));
+    }
+    fclose(f);
+    return true;
+}
+
+static void check_baseline(Gate &gate, const std::string &key, double ns_per_op) {
+    for (const std::pair<std::string, double> &b : gate.baseline) {
+        if (b.first == key && ns_per_op > b.second * (1 + gate.tolerance)) {
+            fprintf(stderr, "regression: %s %.3f ns/op, baseline %.3f\n", key.c_str(), ns_per_op, b.second);
+            ++gate.regressions;
+        }
+    }
+}
+
+static void run(const char *container, const char *type, const char *op, size_t n, op_fn fn, const char *note,
+                Gate &gate) {
+    Counts counts;
+    Timer timer;
+    counts.news_start = new_calls;
+    const size_t ops = fn(n, &counts, timer);
+    counts.news = new_calls - counts.news_start;
+
+    double best = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        fn(n, nullptr, timer);
+        if (r == 0 || timer.ns < best) { best = timer.ns; }
+    }
+    const double ns_per_op = best / ops;
+
+    printf("{\"container\":\"%s\",\"type\":\"%s\",\"op\":\"%s\",\"n\":%zu,\"ops\":%zu,"
+           "\"time_ns\":%.0f,\"ns_per_op\":%.3f,\"grows\":%zu,\"news\":%zu",
+        container, type, op, n, ops, best, ns_per_op, counts.grows, counts.news);
+    if (note) {
+        printf(",\"note\":\"%s\"", note);
+    }
+    printf("}\n");
+    fflush(stdout);
+
+    check_baseline(gate, result_key(container, type, op, n), ns_per_op);
+}
+
+template <typename T>
+static void run_type(const char *type, size_t scale, Gate &gate) {
+    const size_t big = 1000000 * scale;
+    const size_t small = 10000 * scale; // quadratic operations
+
+    struct Op {
+        const char *name;
+        size_t n;
+        op_fn dynamic_array;
+        op_fn vector;
+        const char *note = nullptr;
+    };
+    const Op ops[] = {
+        {"push_back", big, op_push_back<DynamicArray<T>, T>, op_push_back<std::vector<T>, T>},
+        {"insert_front", small, op_insert<DynamicArray<T>, T, 0>, op_insert<std::vector<T>, T, 0>},
+        {"insert_middle", small, op_insert<DynamicArray<T>, T, 1>, op_insert<std::vector<T>, T, 1>},
+        {"insert_end", big, op_insert<DynamicArray<T>, T, 2>, op_insert<std::vector<T>, T, 2>},
+        {"erase_middle", small, op_erase<DynamicArray<T>, T>, op_erase<std::vector<T>, T>},
+        {"resize_churn", small, op_churn<DynamicArray<T>, T, 1>, op_churn<std::vector<T>, T, 1>,
+            "DynamicArray::resize also sets the capacity, vector::resize never shrinks it"},
+        {"capacity_churn", small, op_churn<DynamicArray<T>, T, 0>, op_churn<std::vector<T>, T, 0>,
+            "vector shrinks with resize + shrink_to_fit + reserve, DynamicArray with reserve"},
+        {"iterate", big, op_iterate<DynamicArray<T>, T>, op_iterate<std::vector<T>, T>},
+    };
+
+    for (const Op &op : ops) {
+        run("DynamicArray", type, op.name, op.n, op.dynamic_array, op.note, gate);
+        run("std::vector", type, op.name, op.n, op.vector, op.note, gate);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t scale = 1;
+    Gate gate;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            const char *path = argv[++i];
+            if (!load_baseline(gate, path)) {
+                fprintf(stderr, "could not read baseline %s\n", path);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            gate.tolerance = atof(argv[++i]) / 100;
+        } else {
+            scale = strtoul(argv[i], nullptr, 10);
+        }
+    }
+    if (scale == 0) { scale = 1; }
+
+    run_type<uint64_t>("uint64_t", scale, gate);
+    run_type<Entity>("Entity", scale, gate);
+
+    if (gate.regressions > 0) {
+        fprintf(stderr, "%d result(s) slower than the baseline by more than %.0f%%\n", gate.regressions,
+            gate.tolerance * 100);
+        return 1;
+    }
+}
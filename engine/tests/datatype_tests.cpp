@@ -1,9 +1,20 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
 #include <cstdint>
+#include <stdexcept>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "phyber/utils/bitset.h"
 #include "phyber/utils/datatypes.h"
+#include "phyber/utils/memory.h"
+#include "phyber/utils/snapshot.h"
+#include "phyber/utils/string_id.h"
+#include "phyber/utils/virtual_array.h"
 
 TEST_CASE("DynamicArray trivially-copiable type", "[DynamicArray]") {
     SECTION("DynamicArray default construction") {
@@ -158,6 +169,21 @@ TEST_CASE("DynamicArray trivially-copiable type", "[DynamicArray]") {
         CHECK(arr.capacity() == arr.size());
     }
 
+    SECTION("reserve(0) frees the storage and empties the array") {
+        Phyber::DynamicArray<int> arr;
+        arr.push_back(1);
+        arr.push_back(2);
+
+        arr.reserve(0);
+        CHECK(arr.capacity() == 0);
+        CHECK(arr.size() == 0);
+        CHECK(arr.begin() == nullptr);
+
+        arr.push_back(3);
+        CHECK(arr.size() == 1);
+        CHECK(arr[0] == 3);
+    }
+
     SECTION("out of bounds insert throws") {
         Phyber::DynamicArray<int> arr;
 
@@ -281,6 +307,10 @@ int Track::destructions = 0;
 int Track::copies = 0;
 int Track::moves = 0;
 
+struct alignas(64) AlignedTrack {
+    Track track;
+};
+
 TEST_CASE("DynamicArray non-trivially copyable", "[DynamicArray]") {
     SECTION("push_back and move semantics") {
         Track::reset_counters();
@@ -382,4 +412,793 @@ TEST_CASE("DynamicArray non-trivially copyable", "[DynamicArray]") {
         }
         CHECK(Track::destructions == Track::constructions);
     }
+
+    SECTION("reserve below size destroys the dropped elements") {
+        Track::reset_counters();
+        {
+            Phyber::DynamicArray<Track> arr;
+            for (int i = 1; i <= 5; ++i) {
+                arr.push_back(Track(i));
+            }
+
+            arr.reserve(2);
+            CHECK(arr.capacity() == 2);
+            CHECK(arr.size() == 2);
+            CHECK(arr[0].value == 1);
+            CHECK(arr[1].value == 2);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+
+    SECTION("over-aligned elements are freed with the aligned delete") {
+        Track::reset_counters();
+        {
+            Phyber::DynamicArray<AlignedTrack> arr;
+            arr.push_back(AlignedTrack());
+            arr.push_back(AlignedTrack());
+            arr.reserve(8);
+            CHECK(reinterpret_cast<uintptr_t>(arr.begin()) % alignof(AlignedTrack) == 0);
+
+            arr.shrink_to_fit();
+            CHECK(reinterpret_cast<uintptr_t>(arr.begin()) % alignof(AlignedTrack) == 0);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+}
+
+TEST_CASE("SoAArray", "[SoAArray]") {
+    SECTION("SoAArray default construction") {
+        Phyber::SoAArray<float, int> soa;
+
+        CHECK(soa.size() == 0);
+        CHECK(soa.capacity() == 0);
+    }
+
+    SECTION("push_back writes every column") {
+        Phyber::SoAArray<float, int, char> soa;
+
+        soa.push_back(1.5f, 10, 'a');
+        soa.push_back(2.5f, 20, 'b');
+
+        CHECK(soa.size() == 2);
+        CHECK(soa.get<0>(0) == 1.5f);
+        CHECK(soa.get<1>(1) == 20);
+        CHECK(soa.get<2>(1) == 'b');
+    }
+
+    SECTION("columns are aligned and contiguous") {
+        Phyber::SoAArray<float, double> soa;
+        for (int i = 0; i < 100; ++i) {
+            soa.push_back(float(i), double(i) * 2);
+        }
+
+        CHECK(reinterpret_cast<uintptr_t>(soa.data<0>()) % PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT == 0);
+        CHECK(reinterpret_cast<uintptr_t>(soa.data<1>()) % PHYBER_ENGINE_SOA_COLUMN_ALIGNMENT == 0);
+
+        std::span<float> xs = soa.column<0>();
+        CHECK(xs.size() == 100);
+        for (size_t i = 0; i < xs.size(); ++i) {
+            xs[i] += 1.0f;
+        }
+        CHECK(soa.get<0>(99) == 100.0f);
+        CHECK(soa.get<1>(99) == 198.0);
+    }
+
+    SECTION("erase keeps order") {
+        Phyber::SoAArray<int, int> soa;
+        soa.push_back(1, 10);
+        soa.push_back(2, 20);
+        soa.push_back(3, 30);
+
+        soa.erase(0);
+
+        CHECK(soa.size() == 2);
+        CHECK(soa.get<0>(0) == 2);
+        CHECK(soa.get<1>(0) == 20);
+        CHECK(soa.get<0>(1) == 3);
+        CHECK(soa.get<1>(1) == 30);
+    }
+
+    SECTION("swap_remove moves last element") {
+        Phyber::SoAArray<int, int> soa;
+        soa.push_back(1, 10);
+        soa.push_back(2, 20);
+        soa.push_back(3, 30);
+
+        soa.swap_remove(0);
+
+        CHECK(soa.size() == 2);
+        CHECK(soa.get<0>(0) == 3);
+        CHECK(soa.get<1>(0) == 30);
+        CHECK(soa.get<0>(1) == 2);
+    }
+
+    SECTION("zip iteration") {
+        Phyber::SoAArray<int, float> soa;
+        soa.push_back(1, 0.5f);
+        soa.push_back(2, 1.5f);
+
+        for (auto [i, f] : soa) {
+            f += i;
+        }
+
+        CHECK(soa.get<1>(0) == 1.5f);
+        CHECK(soa.get<1>(1) == 3.5f);
+    }
+
+    SECTION("out of bounds erase throws") {
+        Phyber::SoAArray<int> soa;
+        CHECK_THROWS_AS(soa.erase(0), std::out_of_range);
+        CHECK_THROWS_AS(soa.swap_remove(0), std::out_of_range);
+    }
+
+    SECTION("non-trivial fields are constructed and destroyed") {
+        Track::reset_counters();
+        {
+            Phyber::SoAArray<Track, int> soa;
+            for (int i = 0; i < 10; ++i) {
+                soa.push_back(Track(i), i);
+            }
+            soa.swap_remove(2);
+            soa.erase(0);
+            soa.resize(4);
+
+            CHECK(soa.size() == 4);
+            CHECK(soa.get<0>(0).value == 1);
+            CHECK(soa.get<0>(1).value == 9);
+            CHECK(soa.get<1>(1) == 9);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+}
+
+TEST_CASE("BitSet", "[BitSet]") {
+    SECTION("set, clear and test") {
+        Phyber::BitSet bits(130);
+
+        CHECK(bits.size() == 130);
+        CHECK(bits.none());
+
+        bits.set(0);
+        bits.set(64);
+        bits.set(129);
+        CHECK(bits.test(0));
+        CHECK(bits.test(64));
+        CHECK(bits.test(129));
+        CHECK_FALSE(bits.test(1));
+        CHECK(bits.popcount() == 3);
+
+        bits.clear(64);
+        CHECK_FALSE(bits.test(64));
+        CHECK(bits.popcount() == 2);
+    }
+
+    SECTION("find_first_set and find_next_set") {
+        Phyber::BitSet bits(1000);
+
+        CHECK(bits.find_first_set() == Phyber::BitSet::npos);
+
+        bits.set(700);
+        bits.set(999);
+        CHECK(bits.find_first_set() == 700);
+        CHECK(bits.find_next_set(701) == 999);
+        CHECK(bits.find_next_set(1000) == Phyber::BitSet::npos);
+    }
+
+    SECTION("find_next_clear skips full words and stops at size") {
+        Phyber::BitSet bits(300);
+        bits.set_all();
+
+        CHECK(bits.popcount() == 300);
+        CHECK(bits.all());
+        CHECK(bits.find_first_clear() == Phyber::BitSet::npos);
+
+        bits.clear(257);
+        CHECK(bits.find_first_clear() == 257);
+        CHECK(bits.find_next_clear(258) == Phyber::BitSet::npos);
+    }
+
+    SECTION("iteration over set bits") {
+        Phyber::FixedBitSet<256> bits;
+        bits.set(3);
+        bits.set(64);
+        bits.set(255);
+
+        size_t expected[] = {3, 64, 255};
+        size_t n = 0;
+        for (size_t i : bits.set_bits()) {
+            REQUIRE(n < 3);
+            CHECK(i == expected[n++]);
+        }
+        CHECK(n == 3);
+
+        n = 0;
+        bits.for_each_set([&](size_t i) { CHECK(i == expected[n++]); });
+        CHECK(n == 3);
+    }
+
+    SECTION("bulk and, or and andnot") {
+        Phyber::FixedBitSet<200> a, b;
+        a.set(1);
+        a.set(150);
+        b.set(150);
+        b.set(199);
+
+        Phyber::FixedBitSet<200> c = a;
+        c &= b;
+        CHECK(c.popcount() == 1);
+        CHECK(c.test(150));
+
+        c = a;
+        c |= b;
+        CHECK(c.popcount() == 3);
+
+        c = a;
+        c.and_not(b);
+        CHECK(c.popcount() == 1);
+        CHECK(c.test(1));
+    }
+
+    SECTION("size mismatch throws") {
+        Phyber::BitSet a(10), b(20);
+        CHECK_THROWS_AS(a |= b, std::invalid_argument);
+    }
+
+    SECTION("resize keeps bits and clears new ones") {
+        Phyber::BitSet bits(10);
+        bits.set_all();
+        bits.resize(5);
+        bits.resize(200);
+
+        CHECK(bits.popcount() == 5);
+        CHECK(bits.find_first_clear() == 5);
+
+        Phyber::BitSet copy = bits;
+        CHECK(copy == bits);
+    }
+}
+
+TEST_CASE("FlatHashMap", "[FlatHashMap]") {
+    SECTION("FlatHashMap default construction") {
+        Phyber::FlatHashMap<int, int> map;
+
+        CHECK(map.size() == 0);
+        CHECK(map.capacity() == 0);
+        CHECK(map.find(1) == map.end());
+        CHECK_FALSE(map.contains(1));
+    }
+
+    SECTION("insert and find") {
+        Phyber::FlatHashMap<int, int> map;
+
+        CHECK(map.insert(1, 10).second);
+        CHECK(map.insert(2, 20).second);
+        CHECK_FALSE(map.insert(1, 30).second);
+
+        CHECK(map.size() == 2);
+        CHECK(map.at(1) == 10);
+        CHECK(map.find(2)->second == 20);
+        CHECK_THROWS_AS(map.at(3), std::out_of_range);
+    }
+
+    SECTION("operator[] default constructs missing values") {
+        Phyber::FlatHashMap<int, int> map;
+
+        map[5] += 3;
+        map[5] += 4;
+
+        CHECK(map.size() == 1);
+        CHECK(map[5] == 7);
+    }
+
+    SECTION("reserve avoids rehashing") {
+        Phyber::FlatHashMap<int, int> map;
+        map.reserve(1000);
+        size_t capacity = map.capacity();
+
+        for (int i = 0; i < 1000; ++i) {
+            map.insert(i, i);
+        }
+        CHECK(map.capacity() == capacity);
+    }
+
+    SECTION("many inserts and erases") {
+        Phyber::FlatHashMap<int, int> map;
+        for (int i = 0; i < 10000; ++i) {
+            map.insert(i, i * 2);
+        }
+        for (int i = 0; i < 10000; i += 2) {
+            CHECK(map.erase(i));
+        }
+        CHECK_FALSE(map.erase(0));
+        CHECK(map.size() == 5000);
+
+        bool all_found = true;
+        for (int i = 0; i < 10000; ++i) {
+            bool found = map.contains(i);
+            all_found &= (i % 2 == 1) == found;
+            if (found) {
+                all_found &= map.at(i) == i * 2;
+            }
+        }
+        CHECK(all_found);
+
+        size_t n = 0;
+        for (auto &[key, value] : map) {
+            CHECK(value == key * 2);
+            ++n;
+        }
+        CHECK(n == 5000);
+    }
+
+    SECTION("heterogeneous string lookup") {
+        Phyber::FlatHashMap<std::string, int> map;
+        map.insert(std::string("player"), 1);
+        map["enemy"] = 2;
+
+        CHECK(map.contains("player"));
+        CHECK(map.contains(std::string_view("enemy")));
+        CHECK(map.find("missing") == map.end());
+        CHECK(map.at("enemy") == 2);
+        CHECK(map.erase("player"));
+        CHECK(map.size() == 1);
+    }
+
+    SECTION("clear destroys values") {
+        Track::reset_counters();
+        {
+            Phyber::FlatHashMap<int, Track> map;
+            for (int i = 0; i < 100; ++i) {
+                map.try_emplace(i, i);
+            }
+            map.erase(50);
+            map.clear();
+            CHECK(map.size() == 0);
+            map.try_emplace(1, 1);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+}
+
+TEST_CASE("SparseSet", "[SparseSet]") {
+    SECTION("insert, contains and find") {
+        Phyber::SparseSet<int> set;
+
+        set.insert(3, 30);
+        set.insert(100000, 7);
+
+        CHECK(set.size() == 2);
+        CHECK(set.contains(3));
+        CHECK(set.contains(100000));
+        CHECK_FALSE(set.contains(4));
+        CHECK_FALSE(set.contains(50000));
+        CHECK(*set.find(3) == 30);
+        CHECK(set.find(4) == nullptr);
+        CHECK_THROWS_AS(set.at(4), std::out_of_range);
+    }
+
+    SECTION("insert overwrites existing ids") {
+        Phyber::SparseSet<int> set;
+        set.insert(1, 10);
+        set.insert(1, 11);
+
+        CHECK(set.size() == 1);
+        CHECK(set.at(1) == 11);
+    }
+
+    SECTION("INVALID is not a valid id") {
+        Phyber::SparseSet<int> set;
+        const int value = 1;
+        CHECK_THROWS_AS(set.insert(Phyber::SparseSet<int>::INVALID, value), std::invalid_argument);
+        CHECK_THROWS_AS(set.insert(Phyber::SparseSet<int>::INVALID, 2), std::invalid_argument);
+
+        CHECK(set.size() == 0);
+        CHECK_FALSE(set.contains(Phyber::SparseSet<int>::INVALID));
+    }
+
+    SECTION("erase swaps the last value in") {
+        Phyber::SparseSet<int> set;
+        set.insert(1, 10);
+        set.insert(2, 20);
+        set.insert(3, 30);
+
+        CHECK(set.erase(1));
+        CHECK_FALSE(set.erase(1));
+
+        CHECK(set.size() == 2);
+        CHECK(set.values()[0] == 30);
+        CHECK(set.ids()[0] == 3);
+        CHECK(set.at(3) == 30);
+        CHECK(set.at(2) == 20);
+    }
+
+    SECTION("dense iteration") {
+        Phyber::SparseSet<int> set;
+        for (uint32_t i = 0; i < 100; ++i) {
+            set.insert(i * 97, int(i));
+        }
+
+        int sum = 0;
+        for (int v : set) {
+            sum += v;
+        }
+        CHECK(sum == 99 * 100 / 2);
+    }
+
+    SECTION("sort reorders dense arrays and keeps lookups valid") {
+        Phyber::SparseSet<float> set;
+        set.insert(10, 3.0f);
+        set.insert(20, 1.0f);
+        set.insert(30, 2.0f);
+        set.insert(40, 0.5f);
+
+        set.sort([](float a, float b) { return a < b; });
+
+        CHECK(set.values()[0] == 0.5f);
+        CHECK(set.values()[1] == 1.0f);
+        CHECK(set.values()[2] == 2.0f);
+        CHECK(set.values()[3] == 3.0f);
+        CHECK(set.ids()[0] == 40);
+        CHECK(set.ids()[3] == 10);
+        CHECK(set.at(10) == 3.0f);
+        CHECK(set.at(30) == 2.0f);
+    }
+
+    SECTION("clear empties the set") {
+        Phyber::SparseSet<int> set;
+        set.insert(5, 1);
+        set.clear();
+
+        CHECK(set.size() == 0);
+        CHECK_FALSE(set.contains(5));
+    }
+}
+
+TEST_CASE("BlockArray", "[BlockArray]") {
+    SECTION("BlockArray default construction") {
+        Phyber::BlockArray<int, 8> arr;
+
+        CHECK(arr.size() == 0);
+        CHECK(arr.capacity() == 0);
+        CHECK(arr.begin() == arr.end());
+    }
+
+    SECTION("pointers stay valid while growing") {
+        Phyber::BlockArray<int, 8> arr;
+        int *first = arr.insert(42);
+
+        for (int i = 0; i < 100; ++i) {
+            arr.insert(i);
+        }
+
+        CHECK(arr.size() == 101);
+        CHECK(arr.chunk_count() == 13);
+        CHECK(*first == 42);
+        CHECK(arr.contains(first));
+    }
+
+    SECTION("erased slots are reused") {
+        Phyber::BlockArray<int, 8> arr;
+        int *a = arr.insert(1);
+        arr.insert(2);
+
+        arr.erase(a);
+        CHECK(arr.size() == 1);
+        CHECK_FALSE(arr.contains(a));
+
+        int *c = arr.insert(3);
+        CHECK(c == a);
+        CHECK(arr.chunk_count() == 1);
+    }
+
+    SECTION("erase of foreign pointer throws") {
+        Phyber::BlockArray<int, 8> arr;
+        int x = 0;
+        arr.insert(1);
+
+        CHECK_THROWS_AS(arr.erase(&x), std::invalid_argument);
+    }
+
+    SECTION("iteration skips erased slots") {
+        Phyber::BlockArray<int, 4> arr;
+        int *ptrs[10];
+        for (int i = 0; i < 10; ++i) {
+            ptrs[i] = arr.insert(i);
+        }
+        arr.erase(ptrs[0]);
+        arr.erase(ptrs[5]);
+        arr.erase(ptrs[9]);
+
+        int sum = 0;
+        size_t n = 0;
+        for (int v : arr) {
+            sum += v;
+            ++n;
+        }
+        CHECK(n == 7);
+        CHECK(sum == 45 - 0 - 5 - 9);
+
+        sum = 0;
+        arr.for_each([&](int &v) { sum += v; });
+        CHECK(sum == 45 - 0 - 5 - 9);
+    }
+
+    SECTION("non-trivial elements are destroyed") {
+        Track::reset_counters();
+        {
+            Phyber::BlockArray<Track, 4> arr;
+            Track *t = arr.emplace(1);
+            arr.emplace(2);
+            arr.emplace(3);
+            arr.erase(t);
+            arr.clear();
+            arr.emplace(4);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+}
+
+TEST_CASE("VirtualBuffer", "[Memory]") {
+    SECTION("reserve and commit on demand") {
+        Phyber::Memory::Stats before = Phyber::Memory::get_stats();
+        {
+            Phyber::Memory::VirtualBuffer vb(64 * 1024 * 1024);
+
+            CHECK(vb.reserved() >= 64 * 1024 * 1024);
+            CHECK(vb.committed() == 0);
+
+            vb.commit(10);
+            CHECK(vb.committed() == Phyber::Memory::page_size());
+            static_cast<char *>(vb.data())[0] = 1;
+
+            vb.commit(8 * 1024 * 1024);
+            memset(vb.data(), 1, 8 * 1024 * 1024);
+            CHECK(vb.huge_page_bytes() <= vb.committed());
+            CHECK(Phyber::Memory::get_stats().committed_bytes == before.committed_bytes + vb.committed());
+
+            vb.decommit(0);
+            CHECK(vb.committed() == 0);
+            CHECK_THROWS_AS(vb.commit(vb.reserved() + 1), std::out_of_range);
+        }
+        CHECK(Phyber::Memory::get_stats().reserved_bytes == before.reserved_bytes);
+        CHECK(Phyber::Memory::get_stats().committed_bytes == before.committed_bytes);
+    }
+
+    SECTION("large reservations are huge page aligned") {
+        Phyber::Memory::VirtualBuffer vb(PHYBER_ENGINE_HUGE_PAGE_SIZE * 2);
+        CHECK(reinterpret_cast<uintptr_t>(vb.data()) % PHYBER_ENGINE_HUGE_PAGE_SIZE == 0);
+    }
+}
+
+TEST_CASE("VirtualArray", "[VirtualArray]") {
+    SECTION("growth does not move elements") {
+        Phyber::VirtualArray<int> arr(1000000);
+
+        arr.push_back(1);
+        int *first = arr.begin();
+        for (int i = 0; i < 100000; ++i) {
+            arr.push_back(i);
+        }
+
+        CHECK(arr.begin() == first);
+        CHECK(arr.size() == 100001);
+        CHECK(arr[100000] == 99999);
+    }
+
+    SECTION("growth stops at the reservation") {
+        Phyber::VirtualArray<int> arr(10);
+        size_t max = arr.max_capacity();
+        CHECK(max >= 10);
+
+        for (size_t i = 0; i < max; ++i) {
+            arr.push_back(int(i));
+        }
+        CHECK(arr.capacity() == max);
+        CHECK_THROWS_AS(arr.push_back(0), std::length_error);
+        CHECK_THROWS_AS(arr.reserve(max + 1), std::length_error);
+    }
+
+    SECTION("non-trivial elements") {
+        Track::reset_counters();
+        {
+            Phyber::VirtualArray<Track> arr(1000);
+            for (int i = 0; i < 100; ++i) {
+                arr.push_back(Track(i));
+            }
+            arr.pop_back();
+            arr.resize(10);
+            arr.shrink_to_fit();
+            CHECK(arr.capacity() == 10);
+            CHECK(arr[9].value == 9);
+        }
+        CHECK(Track::destructions == Track::constructions);
+    }
+}
+
+TEST_CASE("StringId", "[StringId]") {
+    SECTION("literals are hashed at compile time") {
+        constexpr Phyber::StringId a = "a";
+        static_assert(a.hash() == 0xaf63dc4c8601ec8cull);
+        static_assert(Phyber::StringId("player") != Phyber::StringId("enemy"));
+        CHECK(Phyber::StringId().empty());
+        CHECK_FALSE(a.empty());
+    }
+
+    SECTION("the empty string is the empty id") {
+        constexpr Phyber::StringId empty = "";
+        static_assert(empty.hash() == 0);
+        static_assert(empty == Phyber::StringId());
+        CHECK(empty.empty());
+        CHECK(Phyber::StringId(std::string_view("")).empty());
+        CHECK(Phyber::StringId(std::string_view("")) == Phyber::StringId());
+    }
+
+    SECTION("runtime strings match literals") {
+        std::string name = "asset/textures/player.png";
+        Phyber::StringId runtime(name);
+        CHECK(runtime == Phyber::StringId("asset/textures/player.png"));
+        CHECK(runtime.hash() == Phyber::StringIdUtils::fnv1a(name.data(), name.size()));
+        CHECK(Phyber::StringId::from_hash(runtime.hash()) == runtime);
+    }
+
+    SECTION("reverse lookup") {
+        Phyber::StringId id(std::string_view("event/window_resized"));
+        CHECK(std::string(id.str()) == "event/window_resized");
+        CHECK(std::string(Phyber::StringId::from_hash(12345).str()) == "<unknown>");
+        CHECK(Phyber::StringIdUtils::lookup(12345) == nullptr);
+
+        // interning the same string again doesn't store a second copy
+        size_t count = Phyber::StringIdUtils::interned_count();
+        Phyber::StringId again(std::string_view("event/window_resized"));
+        CHECK(again.str() == id.str());
+        CHECK(Phyber::StringIdUtils::interned_count() == count);
+    }
+
+    SECTION("big strings don't share storage with small ones") {
+        Phyber::StringId small_one(std::string_view("small-one"));
+        std::string big(5000, 'x');
+        Phyber::StringId big_id(big);
+        Phyber::StringId small_two(std::string_view("small-two"));
+
+        CHECK(std::string(small_one.str()) == "small-one");
+        CHECK(std::string(big_id.str()) == big);
+        CHECK(std::string(small_two.str()) == "small-two");
+    }
+
+    SECTION("usable as a hash map key") {
+        Phyber::FlatHashMap<Phyber::StringId, int> map;
+        map[Phyber::StringId("health")] = 100;
+        map[Phyber::StringId(std::string_view("mana"))] = 50;
+        CHECK(map.at(Phyber::StringId(std::string_view("health"))) == 100);
+        CHECK(map.at(Phyber::StringId("mana")) == 50);
+    }
+
+    SECTION("concurrent interning") {
+        std::atomic<int> mismatches {0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 1000; ++i) {
+                    std::string name = "component_" + std::to_string(i);
+                    Phyber::StringId id(name);
+                    if (name != id.str()) {
+                        mismatches.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        CHECK(mismatches.load() == 0);
+        CHECK(std::string(Phyber::StringId(std::string_view("component_999")).str()) == "component_999");
+    }
+}
+
+// the message of the std::runtime_error opening path throws, "" if none
+template <typename T>
+static std::string snapshot_error(const char *path) {
+    try {
+        Phyber::Snapshot::View<T> view(path);
+    } catch (const std::runtime_error &e) {
+        return e.what();
+    }
+    return "";
+}
+
+TEST_CASE("Snapshot", "[Snapshot]") {
+    struct Tile {
+        uint16_t kind;
+        uint8_t flags;
+        float height;
+    };
+    const char *path = "phyber_snapshot_test.bin";
+
+    Phyber::DynamicArray<Tile> tiles;
+    for (int i = 0; i < 5000; ++i) {
+        tiles.push_back(Tile {static_cast<uint16_t>(i), static_cast<uint8_t>(i & 7), i * 0.25f});
+    }
+    Phyber::Snapshot::save(path, tiles);
+
+    SECTION("load round trip") {
+        Phyber::DynamicArray<Tile> loaded;
+        Phyber::Snapshot::load(path, loaded);
+        REQUIRE(loaded.size() == tiles.size());
+        CHECK(memcmp(loaded.begin(), tiles.begin(), tiles.size() * sizeof(Tile)) == 0);
+    }
+
+    SECTION("mapped view") {
+        Phyber::Snapshot::View<Tile> view(path, true);
+        CHECK(view.size() == 5000);
+        CHECK(reinterpret_cast<uintptr_t>(view.data()) % alignof(Tile) == 0);
+        CHECK(view[1234].kind == 1234);
+        CHECK(view.at(4999).height == 4999 * 0.25f);
+        CHECK_THROWS_AS(view.at(5000), std::out_of_range);
+        CHECK(view.verify());
+
+        size_t n = 0;
+        for (const Tile &t : view) {
+            n += t.flags == (n & 7);
+        }
+        CHECK(n == 5000);
+    }
+
+    SECTION("empty arrays") {
+        Phyber::DynamicArray<Tile> empty;
+        Phyber::Snapshot::save(path, empty);
+        Phyber::Snapshot::View<Tile> view(path, true);
+        CHECK(view.empty());
+
+        Phyber::DynamicArray<Tile> loaded;
+        loaded.push_back(tiles[0]);
+        Phyber::Snapshot::load(path, loaded);
+        CHECK(loaded.size() == 0);
+    }
+
+    SECTION("bad files are rejected") {
+        CHECK_THROWS_AS(Phyber::Snapshot::View<Tile>("phyber_snapshot_missing.bin"), std::runtime_error);
+        CHECK_THROWS_AS(Phyber::Snapshot::View<uint64_t>(path), std::runtime_error);
+
+        // flip one byte of element data
+        Phyber::Snapshot::save(path, tiles);
+        FILE *f = fopen(path, "r+b");
+        REQUIRE(f);
+        fseek(f, sizeof(Phyber::Snapshot::Header) + 100, SEEK_SET);
+        fputc(0xAB, f);
+        fclose(f);
+
+        Phyber::DynamicArray<Tile> loaded;
+        CHECK_THROWS_AS(Phyber::Snapshot::load(path, loaded), std::runtime_error);
+        Phyber::Snapshot::View<Tile> unchecked(path);
+        CHECK_FALSE(unchecked.verify());
+    }
+
+    SECTION("truncated files and bad data offsets are rejected") {
+        Phyber::Snapshot::save(path, tiles);
+        FILE *f = fopen(path, "rb");
+        REQUIRE(f);
+        std::string bytes(sizeof(Phyber::Snapshot::Header) + tiles.size() * sizeof(Tile), '\0');
+        REQUIRE(fread(bytes.data(), 1, bytes.size(), f) == bytes.size());
+        fclose(f);
+
+        // cut off in the middle of the elements
+        f = fopen(path, "wb");
+        REQUIRE(f);
+        fwrite(bytes.data(), 1, bytes.size() / 2, f);
+        fclose(f);
+        CHECK(snapshot_error<Tile>(path).find("truncated or corrupt file") != std::string::npos);
+
+        // data offset past the end of the file
+        Phyber::Snapshot::Header header;
+        memcpy(&header, bytes.data(), sizeof(header));
+        header.data_offset = static_cast<uint32_t>(bytes.size() + 64);
+        memcpy(bytes.data(), &header, sizeof(header));
+        f = fopen(path, "wb");
+        REQUIRE(f);
+        fwrite(bytes.data(), 1, bytes.size(), f);
+        fclose(f);
+        CHECK(snapshot_error<Tile>(path).find("truncated or corrupt file") != std::string::npos);
+    }
+
+    remove(path);
 }
@@ -0,0 +1,141 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_test_macros.hpp>
+
+#include <SDL3/SDL.h>
+#include <string.h>
+
+#include "phyber/event.h"
+
+using namespace Phyber;
+
+// only the events subsystem, no window is needed to push and poll events
+static void reset_events(bool coalescing) {
+    static bool initialized = SDL_Init(SDL_INIT_EVENTS);
+    REQUIRE(initialized);
+    SDL_FlushEvents(SDL_EVENT_FIRST, SDL_EVENT_LAST);
+    set_event_coalescing(coalescing);
+}
+
+static void push_motion(float x, float y, float dx, float dy, SDL_MouseButtonFlags state = 0) {
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_EVENT_MOUSE_MOTION;
+    event.motion.state = state;
+    event.motion.x = x;
+    event.motion.y = y;
+    event.motion.xrel = dx;
+    event.motion.yrel = dy;
+    SDL_PushEvent(&event);
+}
+
+static void push_wheel(float x, float y, int32_t ticks_y, SDL_MouseWheelDirection direction = SDL_MOUSEWHEEL_NORMAL) {
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_EVENT_MOUSE_WHEEL;
+    event.wheel.x = x;
+    event.wheel.y = y;
+    event.wheel.integer_y = ticks_y;
+    event.wheel.direction = direction;
+    event.wheel.mouse_x = 10;
+    event.wheel.mouse_y = 20;
+    SDL_PushEvent(&event);
+}
+
+static void push_key(SDL_Scancode scancode, bool down) {
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = down ? SDL_EVENT_KEY_DOWN : SDL_EVENT_KEY_UP;
+    event.key.scancode = scancode;
+    event.key.down = down;
+    SDL_PushEvent(&event);
+}
+
+TEST_CASE("Event coalescing", "[Event]") {
+    SECTION("off by default, every event is kept") {
+        reset_events(false);
+        push_motion(1, 1, 1, 1);
+        push_motion(2, 2, 1, 1);
+
+        DynamicArray<Event> events;
+        CHECK(poll_events(events) == 2);
+        CHECK(raw_motion_samples().size() == 0);
+    }
+
+    SECTION("motion is merged, deltas summed and the raw path kept") {
+        reset_events(true);
+        push_motion(1, 2, 1, 2);
+        push_motion(4, 3, 3, 1);
+        push_motion(5, 5, 1, 2);
+
+        DynamicArray<Event> events;
+        REQUIRE(poll_events(events) == 1);
+        CHECK(events[0].type == EventType::MOUSE_MOTION);
+        CHECK(events[0].mouse_motion.x == 5);
+        CHECK(events[0].mouse_motion.y == 5);
+        CHECK(events[0].mouse_motion.dx == 5);
+        CHECK(events[0].mouse_motion.dy == 5);
+
+        REQUIRE(raw_motion_samples().size() == 3);
+        CHECK(raw_motion_samples()[0].x == 1);
+        CHECK(raw_motion_samples()[1].dx == 3);
+        CHECK(raw_motion_samples()[2].y == 5);
+    }
+
+    SECTION("a button state change or another event breaks the merge") {
+        reset_events(true);
+        push_motion(1, 1, 1, 1);
+        push_motion(2, 2, 1, 1, SDL_BUTTON_LMASK);
+        push_motion(3, 3, 1, 1, SDL_BUTTON_LMASK);
+        push_key(4, true);
+        push_motion(4, 4, 1, 1, SDL_BUTTON_LMASK);
+
+        DynamicArray<Event> events;
+        REQUIRE(poll_events(events) == 4);
+        CHECK(events[0].mouse_motion.dx == 1);
+        CHECK(events[1].mouse_motion.dx == 2);
+        CHECK(events[1].mouse_motion.is_button_left());
+        CHECK(events[2].type == EventType::KEYBOARD);
+        CHECK(events[3].mouse_motion.dx == 1);
+        CHECK(raw_motion_samples().size() == 4);
+    }
+
+    SECTION("wheel amounts are summed until the direction changes") {
+        reset_events(true);
+        push_wheel(0, 1, 1);
+        push_wheel(0.5f, 1, 1);
+        push_wheel(0, 1, 1, SDL_MOUSEWHEEL_FLIPPED);
+
+        DynamicArray<Event> events;
+        REQUIRE(poll_events(events) == 2);
+        CHECK(events[0].mouse_wheel.x == 0.5f);
+        CHECK(events[0].mouse_wheel.y == 2);
+        CHECK(events[0].mouse_wheel.integer_y == 2);
+        CHECK(events[0].mouse_wheel.mouse_x == 10);
+        CHECK(events[1].mouse_wheel.direction == MouseWheelEvent::FLIPPED);
+        CHECK(events[1].mouse_wheel.y == 1);
+    }
+
+    SECTION("a full buffer still takes events that merge into its last one") {
+        reset_events(true);
+        push_key(4, true);
+        push_motion(1, 1, 1, 1);
+        push_motion(2, 2, 1, 1);
+        push_motion(3, 3, 1, 1);
+        push_key(4, false);
+
+        Event out[2];
+        REQUIRE(poll_events(out, 2) == 2);
+        CHECK(out[0].type == EventType::KEYBOARD);
+        CHECK(out[1].mouse_motion.x == 3);
+        CHECK(out[1].mouse_motion.dx == 3);
+        CHECK(raw_motion_samples().size() == 3);
+
+        // the key release didn't merge and stays queued for the next call
+        REQUIRE(poll_events(out, 2) == 1);
+        CHECK(out[0].type == EventType::KEYBOARD);
+        CHECK_FALSE(out[0].keyboard.down);
+        CHECK(raw_motion_samples().size() == 0);
+    }
+
+    set_event_coalescing(false);
+}
@@ -0,0 +1,140 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_test_macros.hpp>
+
+#include "phyber/input.h"
+
+using namespace Phyber;
+
+typedef KeyboardEvent::KeySymbol KeySymbol;
+
+static Event key_event(KeySymbol::PhysicalKey key, bool down, bool repeat = false) {
+    Event event {};
+    event.type = EventType::KEYBOARD;
+    event.keyboard.key.physical_key = key;
+    event.keyboard.key.virtual_key = KeySymbol::VK_UNKNOWN;
+    event.keyboard.key.key_modifier = KeySymbol::KMOD_NONE;
+    event.keyboard.down = down;
+    event.keyboard.repeat = repeat;
+    return event;
+}
+
+static Event button_event(MouseButtonFlags button, bool down, float x, float y) {
+    Event event {};
+    event.type = EventType::MOUSE_BUTTON;
+    event.mouse_button.button = button;
+    event.mouse_button.down = down;
+    event.mouse_button.clicks = 1;
+    event.mouse_button.x = x;
+    event.mouse_button.y = y;
+    return event;
+}
+
+static Event motion_event(float x, float y, float dx, float dy) {
+    Event event {};
+    event.type = EventType::MOUSE_MOTION;
+    event.mouse_motion.x = x;
+    event.mouse_motion.y = y;
+    event.mouse_motion.dx = dx;
+    event.mouse_motion.dy = dy;
+    return event;
+}
+
+TEST_CASE("InputState keys", "[Input]") {
+    SECTION("held keys and edges across frames") {
+        InputState input;
+        Event frame1[] = {key_event(KeySymbol::PK_W, true), key_event(KeySymbol::PK_W, true, true)};
+        input.update(frame1, 2);
+        CHECK(input.is_down(KeySymbol::PK_W));
+        CHECK(input.was_pressed(KeySymbol::PK_W));
+        CHECK_FALSE(input.was_down(KeySymbol::PK_W));
+        CHECK_FALSE(input.is_down(KeySymbol::PK_A));
+
+        input.update(nullptr, 0);
+        CHECK(input.is_down(KeySymbol::PK_W));
+        CHECK(input.was_down(KeySymbol::PK_W));
+        CHECK_FALSE(input.was_pressed(KeySymbol::PK_W));
+
+        Event frame3[] = {key_event(KeySymbol::PK_W, false)};
+        input.update(frame3, 1);
+        CHECK_FALSE(input.is_down(KeySymbol::PK_W));
+        CHECK(input.was_released(KeySymbol::PK_W));
+    }
+
+    SECTION("a tap within one frame is pressed and released") {
+        InputState input;
+        Event frame[] = {key_event(KeySymbol::PK_SPACE, true), key_event(KeySymbol::PK_SPACE, false)};
+        input.update(frame, 2);
+        CHECK_FALSE(input.is_down(KeySymbol::PK_SPACE));
+        CHECK(input.was_pressed(KeySymbol::PK_SPACE));
+        CHECK(input.was_released(KeySymbol::PK_SPACE));
+    }
+
+    SECTION("keys in every word of the bitset") {
+        InputState input;
+        Event frame[] = {key_event(KeySymbol::PK_A, true), key_event(KeySymbol::PK_RGUI, true),
+            key_event(KeySymbol::PK_ENDCALL, true)};
+        input.update(frame, 3);
+        CHECK(input.is_down(KeySymbol::PK_A));
+        CHECK(input.is_down(KeySymbol::PK_RGUI));
+        CHECK(input.is_down(KeySymbol::PK_ENDCALL));
+        CHECK_FALSE(input.is_down(KeySymbol::PK_B));
+    }
+
+    SECTION("keys past KEY_COUNT are never down") {
+        InputState input;
+        Event frame[] = {key_event(KeySymbol::PK_A, true)};
+        input.update(frame, 1);
+        // would alias PK_A if the word index wrapped around
+        const InputState::Key aliased = static_cast<InputState::Key>(KeySymbol::PK_A + InputState::KEY_COUNT);
+        CHECK_FALSE(input.is_down(aliased));
+        CHECK_FALSE(input.was_pressed(aliased));
+
+        input.update(nullptr, 0);
+        CHECK_FALSE(input.was_down(aliased));
+        Event release[] = {key_event(KeySymbol::PK_A, false)};
+        input.update(release, 1);
+        CHECK_FALSE(input.was_released(aliased));
+    }
+}
+
+TEST_CASE("InputState mouse", "[Input]") {
+    SECTION("motion is summed, the position is the last one") {
+        InputState input;
+        Event frame[] = {motion_event(10, 20, 1, 2), motion_event(13, 18, 3, -2)};
+        input.update(frame, 2);
+        CHECK(input.mouse_x == 13);
+        CHECK(input.mouse_y == 18);
+        CHECK(input.mouse_dx == 4);
+        CHECK(input.mouse_dy == 0);
+
+        input.update(nullptr, 0);
+        CHECK(input.mouse_x == 13);
+        CHECK(input.mouse_dx == 0);
+    }
+
+    SECTION("buttons and their edges") {
+        InputState input;
+        Event frame1[] = {button_event(BUTTON_LEFT, true, 5, 6)};
+        input.update(frame1, 1);
+        CHECK(input.is_down(BUTTON_LEFT));
+        CHECK(input.was_pressed(BUTTON_LEFT));
+        CHECK_FALSE(input.is_down(BUTTON_RIGHT));
+        CHECK(input.mouse_x == 5);
+
+        Event frame2[] = {button_event(BUTTON_LEFT, false, 5, 6)};
+        input.update(frame2, 1);
+        CHECK_FALSE(input.is_down(BUTTON_LEFT));
+        CHECK_FALSE(input.was_pressed(BUTTON_LEFT));
+        CHECK(input.was_released(BUTTON_LEFT));
+    }
+
+    SECTION("buttons outside 1..32 are ignored") {
+        InputState input;
+        Event frame[] = {button_event(BUTTON_LEFT, true, 0, 0), button_event(static_cast<MouseButtonFlags>(0), true, 0, 0)};
+        input.update(frame, 2);
+        CHECK(input.buttons == 1);
+        CHECK_FALSE(input.is_down(static_cast<MouseButtonFlags>(0)));
+        CHECK_FALSE(input.was_pressed(static_cast<MouseButtonFlags>(0)));
+        CHECK_FALSE(input.was_released(static_cast<MouseButtonFlags>(33)));
+    }
+}
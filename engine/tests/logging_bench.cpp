@@ -0,0 +1,212 @@
+#include "phyber/logging.h"
+#include "phyber/log/flight.h"
+#include "phyber/log/sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define fdopen _fdopen
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// caller side cost of a log call for every output mode and 1 to N producer
+// threads. Log output goes to /dev/null or a temporary file, results are
+// printed as one JSON object per line:
+//   msgs_per_sec  messages over the wall time until everything is written,
+//                 for async modes this includes draining the queues
+//   p50_ns...     latency of single calls, clock overhead included
+//   dropped       records lost to a full async queue, BLOCK is used so
+//                 this should stay 0
+// usage: phyber_engine_logging_bench [messages per thread]
+
+using namespace Phyber;
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static const char *FILE_PATH = "phyber_logging_bench.log";
+static const char *BINARY_PATH = "phyber_logging_bench.phylog";
+
+enum class Mode {
+    STDOUT,   // sync, straight to the (redirected) stdout
+    FILE,     // sync, FileSink
+    ASYNC,    // formatted on the caller, written by the writer thread
+    DEFERRED, // raw arguments, formatted by the writer thread
+    BINARY,   // raw arguments, binary log file
+    DISABLED, // level filtered out at runtime
+    FLIGHT    // filtered out, only kept by the flight recorder
+};
+
+static const char *mode_name(Mode mode) {
+    switch (mode) {
+    case Mode::STDOUT: return "stdout";
+    case Mode::FILE: return "file";
+    case Mode::ASYNC: return "async";
+    case Mode::DEFERRED: return "deferred";
+    case Mode::BINARY: return "binary";
+    case Mode::DISABLED: return "disabled";
+    case Mode::FLIGHT: return "flight";
+    }
+    return "?";
+}
+
+static void log_message(bool debug, uint64_t i) {
+    if (debug) {
+        PHYBER_LOG_DEBUG("Bench %s, message %llu value %f", "logging", static_cast<unsigned long long>(i), 0.5);
+    } else {
+        PHYBER_LOG_INFO("Bench %s, message %llu value %f", "logging", static_cast<unsigned long long>(i), 0.5);
+    }
+}
+
+static uint64_t percentile(const std::vector<uint32_t> &sorted, double p) {
+    size_t i = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[i];
+}
+
+static void run(FILE *report, Mode mode, int threads, uint64_t per_thread) {
+    Log::FileSink *file = nullptr;
+    Log::AsyncConfig async;
+    async.overflow = Log::OverflowPolicy::BLOCK;
+    switch (mode) {
+    case Mode::FILE:
+        file = new Log::FileSink(FILE_PATH);
+        Log::set_sink(file);
+        break;
+    case Mode::DEFERRED:
+        async.defer_formatting = true;
+        Log::start_async(async);
+        break;
+    case Mode::BINARY:
+        async.binary_path = BINARY_PATH;
+        Log::start_async(async);
+        break;
+    case Mode::ASYNC:
+        Log::start_async(async);
+        break;
+    case Mode::FLIGHT:
+        Log::start_flight_recorder();
+        Log::set_level(Log::Level::INFO);
+        break;
+    case Mode::DISABLED:
+        Log::set_level(Log::Level::INFO);
+        break;
+    case Mode::STDOUT:
+        break;
+    }
+    const bool debug = mode == Mode::DISABLED || mode == Mode::FLIGHT;
+    const uint64_t dropped_before = Log::dropped_count();
+
+    std::vector<std::vector<uint32_t>> latencies(threads);
+    std::vector<std::thread> producers;
+    std::atomic<int> ready {0};
+    std::atomic<bool> go {false};
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&, t] {
+            std::vector<uint32_t> &lat = latencies[t];
+            lat.resize(per_thread);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (uint64_t i = 0; i < per_thread; ++i) {
+                auto start = bench_clock_t::now();
+                log_message(debug, i);
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock_t::now() - start).count();
+                lat[i] = ns > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(ns);
+            }
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto start = bench_clock_t::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &t : producers) {
+        t.join();
+    }
+    Log::flush();
+    double seconds = std::chrono::duration<double>(bench_clock_t::now() - start).count();
+    const uint64_t dropped = Log::dropped_count() - dropped_before;
+
+    switch (mode) {
+    case Mode::FILE:
+        Log::set_sink(nullptr);
+        delete file;
+        remove(FILE_PATH);
+        break;
+    case Mode::ASYNC:
+    case Mode::DEFERRED:
+    case Mode::BINARY:
+        Log::stop_async();
+        remove(BINARY_PATH);
+        break;
+    case Mode::FLIGHT:
+        Log::stop_flight_recorder();
+        Log::set_level(Log::Level::DEBUG);
+        break;
+    case Mode::DISABLED:
+        Log::set_level(Log::Level::DEBUG);
+        break;
+    case Mode::STDOUT:
+        break;
+    }
+
+    std::vector<uint32_t> all;
+    all.reserve(per_thread * threads);
+    for (const std::vector<uint32_t> &lat : latencies) {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+    const uint64_t total = per_thread * threads;
+
+    fprintf(report, "{\"mode\":\"%s\",\"threads\":%d,\"messages\":%llu,\"msgs_per_sec\":%.0f,"
+        "\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu,\"dropped\":%llu}\n",
+        mode_name(mode), threads, static_cast<unsigned long long>(total), total / seconds,
+        static_cast<unsigned long long>(percentile(all, 0.5)),
+        static_cast<unsigned long long>(percentile(all, 0.9)),
+        static_cast<unsigned long long>(percentile(all, 0.99)),
+        static_cast<unsigned long long>(percentile(all, 0.999)),
+        static_cast<unsigned long long>(all.back()),
+        static_cast<unsigned long long>(dropped));
+    fflush(report);
+}
+
+int main(int argc, char **argv) {
+    uint64_t per_thread = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    if (per_thread == 0) { per_thread = 1; }
+
+    // results go to the real stdout, log output to the null device
+    fflush(stdout);
+    FILE *report = fdopen(dup(1), "w");
+    int null_fd = open(NULL_DEVICE, O_WRONLY);
+    if (!report || null_fd < 0) {
+        fprintf(stderr, "could not redirect stdout\n");
+        return 1;
+    }
+    dup2(null_fd, 1);
+
+    unsigned int hw = std::thread::hardware_concurrency();
+    int max_threads = hw >= 8 ? 8 : (hw >= 4 ? 4 : 2);
+    const Mode modes[] = {Mode::STDOUT, Mode::FILE, Mode::ASYNC, Mode::DEFERRED, Mode::BINARY, Mode::DISABLED,
+        Mode::FLIGHT};
+    for (Mode mode : modes) {
+        for (int t = 1; t <= max_threads; t *= 2) {
+            run(report, mode, t, per_thread);
+        }
+    }
+    fclose(report);
+}
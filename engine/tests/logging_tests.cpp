@@ -1,4 +1,84 @@
 #include "phyber/logging.h"
+#include "phyber/log/binary.h"
+#include "phyber/log/flight.h"
+#include "phyber/log/format.h"
+#include "phyber/log/sink.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool file_exists(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f) { fclose(f); }
+    return f != nullptr;
+}
+
+// discards everything, the first write stalls so async queues fill up
+class StallingSink : public Phyber::Log::Sink {
+private:
+    std::atomic<bool> _stalled {false};
+
+public:
+    void write(const char *, size_t) override {
+        if (!_stalled.exchange(true)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+};
+
+// counts the messages containing a marker, written by any thread
+class CountingSink : public Phyber::Log::Sink {
+private:
+    const char *_marker;
+
+public:
+    std::atomic<int> count {0};
+
+    explicit CountingSink(const char *marker) : _marker(marker) {}
+
+    void write(const char *data, size_t size) override {
+        if (std::string_view(data, size).find(_marker) != std::string_view::npos) {
+            ++count;
+        }
+    }
+};
+
+// logs from its destructor, which runs after the thread's queue is closed
+// when the first log call on the thread comes after its construction. The
+// wait gives the writer time to free the closed queue
+struct LogsOnExit {
+    int thread = 0;
+    ~LogsOnExit() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        PHYBER_LOG_INFO("Teardown, thread %i", thread);
+    }
+};
+
+// formats the arguments both ways, deferred formatting has to match printf
+template <typename... A>
+static bool check_format(const char *format, A... args) {
+    uint8_t encoded[256] = {};
+    Phyber::Log::Args::encode(encoded, args...);
+    char deferred[256];
+    Phyber::Log::Args::format(format, encoded, Phyber::Log::Args::encoded_size(args...), deferred, sizeof(deferred));
+    char expected[256];
+    snprintf(expected, sizeof(expected), format, args...);
+    if (strcmp(deferred, expected) != 0) {
+        fprintf(stderr, "format \"%s\": got \"%s\", expected \"%s\"\n", format, deferred, expected);
+        return false;
+    }
+    return true;
+}
 
 int main() {
     PHYBER_LOG_DEBUG("Macro, %i", 1);
@@ -6,4 +86,353 @@ int main() {
     PHYBER_LOG_WARNING("Macro, %i", 3);
     PHYBER_LOG_ERROR("Macro, %i", 4);
     PHYBER_LOG_CRITICAL("Macro, %i", 5);
+
+    Phyber::Log::set_time_format(Phyber::Log::TimeFormat::RAW);
+    PHYBER_LOG_INFO("Raw timestamp");
+    Phyber::Log::set_time_format(Phyber::Log::TimeFormat::DATE);
+
+    bool ok = true;
+    ok &= check_format("plain %% text");
+    ok &= check_format("%d %i %5d|%-5d|%05d", -1, 2, 3, 4, 5);
+    ok &= check_format("%u %x %X %o %#x", 7u, -1, 255u, 8u, 16);
+    ok &= check_format("%hhx %hd %lld %llu %zu", 511, 70000, -5ll, ~0ull, sizeof(int));
+    ok &= check_format("%f %.2f %10.3e %g %a", 1.5, 2.345, 1e10, 0.1f, 3.0);
+    ok &= check_format("%s|%10s|%-4s|%.2s", "abc", "right", "l", "cut");
+    ok &= check_format("%*d|%.*f|%c", 6, 42, 1, 2.25, 'z');
+    ok &= check_format("%p %p", static_cast<void *>(&ok), nullptr);
+    if (!ok) { return 1; }
+
+    // disabled sites must not evaluate their arguments
+    int evaluated = 0;
+    Phyber::Log::set_level(Phyber::Log::Level::WARNING);
+    PHYBER_LOG_INFO("Filtered, %i", ++evaluated);
+    Phyber::Log::set_file_level("logging_tests.cpp", Phyber::Log::Level::DEBUG);
+    PHYBER_LOG_INFO("Filter, file level %i", ++evaluated);
+    Phyber::Log::set_module_level("tests", Phyber::Log::Level::ERROR);
+    PHYBER_LOG_DEBUG("Filter, file level beats module level %i", ++evaluated);
+    Phyber::Log::clear_levels();
+    PHYBER_LOG_INFO("Filtered, %i", ++evaluated);
+    Phyber::Log::set_module_level("tests", Phyber::Log::Level::INFO);
+    PHYBER_LOG_DEBUG("Filtered, %i", ++evaluated);
+    Phyber::Log::clear_levels();
+    Phyber::Log::set_level(Phyber::Log::Level::DEBUG);
+
+    // rate limited sites only evaluate their arguments when they log
+    int limited = 0;
+    for (int i = 0; i < 10; ++i) {
+        PHYBER_LOG_EVERY_N(INFO, 4, "Every 4th, call %i", (++limited, i));
+        PHYBER_LOG_FIRST_N(INFO, 2, "First 2, call %i", (++limited, i));
+        PHYBER_LOG_ONCE(INFO, "Once, call %i", (++limited, i));
+        PHYBER_LOG_EVERY_MS(INFO, 60000, "Every minute, call %i", (++limited, i));
+    }
+    // calls 0, 4 and 8, 0 and 1, 0, 0
+    const int expected_limited = Phyber::Log::compiled_in(Phyber::Log::Level::INFO) ? 7 : 0;
+    if (limited != expected_limited) {
+        fprintf(stderr, "%i rate limited log calls evaluated their arguments, expected %i\n", limited, expected_limited);
+        return 1;
+    }
+    const int expected = Phyber::Log::compiled_in(Phyber::Log::Level::INFO) + Phyber::Log::compiled_in(Phyber::Log::Level::DEBUG);
+    if (evaluated != expected) {
+        fprintf(stderr, "%i filtered log calls evaluated their arguments, expected %i\n", evaluated, expected);
+        return 1;
+    }
+
+    Phyber::Log::start_async();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 3; ++i) {
+                PHYBER_LOG_INFO("Async, thread %i message %i", t, i);
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    Phyber::Log::flush();
+    PHYBER_LOG_INFO("Async, %llu dropped", static_cast<unsigned long long>(Phyber::Log::dropped_count()));
+    Phyber::Log::stop_async();
+
+    Phyber::Log::AsyncConfig deferred;
+    deferred.defer_formatting = true;
+    Phyber::Log::start_async(deferred);
+    PHYBER_LOG_INFO("Deferred, %s %i %.1f", "text", 7, 0.5);
+    Phyber::Log::stop_async();
+
+#if defined(__cpp_lib_format)
+    PHYBER_LOGF(INFO, "std::format, {} {:.1f} {}", 42, Phyber::Vec2(1.0f, 2.5f), Phyber::Mat3x3(Phyber::Vec3(1, 2, 3)));
+#endif
+
+    // structured records, as text and as JSON Lines, sync and async
+    PHYBER_LOG_KV(INFO, "Fields", "int", -3, "uint", 7u, "double", 0.25, "string", "a \"quoted\"\n value");
+    Phyber::Log::StdoutSink json(Phyber::Log::Format::JSON);
+    Phyber::Log::set_sink(&json);
+    PHYBER_LOG_KV(INFO, "Fields", "int", -3, "uint", 7u, "double", 0.25, "string", "a \"quoted\"\n value");
+    PHYBER_LOG_INFO("Plain %s as JSON", "message");
+    Phyber::Log::start_async();
+    PHYBER_LOG_KV(WARNING, "Async fields", "frame", 12, "ms", 16.5);
+    Phyber::Log::stop_async();
+    Phyber::Log::set_sink(nullptr);
+
+    const char *path = "phyber_logging_tests.phylog";
+    Phyber::Log::AsyncConfig binary;
+    binary.binary_path = path;
+    Phyber::Log::start_async(binary);
+    for (int i = 0; i < 3; ++i) {
+        PHYBER_LOG_DEBUG("Binary, message %i of %s", i, "three");
+    }
+    Phyber::Log::printf_impl(Phyber::Log::Level::WARNING, __FILE__, __LINE__, "Binary, preformatted %i", 4);
+    PHYBER_LOG_KV(INFO, "Binary fields", "value", 5);
+    Phyber::Log::stop_async();
+
+    FILE *in = fopen(path, "rb");
+    long long count = in ? Phyber::Log::Binary::decode(in, stdout, Phyber::Log::Format::JSON) : -1;
+    if (in) { fclose(in); }
+    remove(path);
+    const long long expected_records =
+        3 * Phyber::Log::compiled_in(Phyber::Log::Level::DEBUG) + 1 + Phyber::Log::compiled_in(Phyber::Log::Level::INFO);
+    if (count != expected_records) {
+        fprintf(stderr, "decoded %lld records, expected %lld\n", count, expected_records);
+        return 1;
+    }
+
+    // a corrupt args length is rejected before anything is allocated for it
+    FILE *corrupt = fopen(path, "wb");
+    if (corrupt) {
+        const uint32_t version = Phyber::Log::Binary::VERSION;
+        const uint8_t site[] = {static_cast<uint8_t>(Phyber::Log::Binary::Entry::SITE), 0, 0, 0, 0,
+            static_cast<uint8_t>(Phyber::Log::Level::INFO), 1, 0, 0, 0, 1, 0, 2, 0, 'f', '%', 'i'};
+        const uint8_t record_type = static_cast<uint8_t>(Phyber::Log::Binary::Entry::RECORD);
+        const uint32_t site_id = 0, thread = 1, args_len = 0xFFFFFF00u;
+        const uint64_t timestamp = 0;
+        fwrite(Phyber::Log::Binary::MAGIC, 1, sizeof(Phyber::Log::Binary::MAGIC), corrupt);
+        fwrite(&version, sizeof(version), 1, corrupt);
+        fwrite(site, 1, sizeof(site), corrupt);
+        fwrite(&record_type, 1, 1, corrupt);
+        fwrite(&site_id, sizeof(site_id), 1, corrupt);
+        fwrite(&timestamp, sizeof(timestamp), 1, corrupt);
+        fwrite(&thread, sizeof(thread), 1, corrupt);
+        fwrite(&args_len, sizeof(args_len), 1, corrupt);
+        fclose(corrupt);
+    }
+    in = fopen(path, "rb");
+    count = in ? Phyber::Log::Binary::decode(in, stdout) : 0;
+    if (in) { fclose(in); }
+    remove(path);
+    if (count != -1) {
+        fprintf(stderr, "corrupt binary log decoded as %lld records\n", count);
+        return 1;
+    }
+
+    // a producer waiting for room in a full queue must not hang when async
+    // mode stops under it
+    StallingSink stalling_sink;
+    Phyber::Log::set_sink(&stalling_sink);
+    Phyber::Log::AsyncConfig blocking;
+    blocking.queue_bytes = 4096;
+    blocking.overflow = Phyber::Log::OverflowPolicy::BLOCK;
+    Phyber::Log::start_async(blocking);
+    std::thread producer([] {
+        for (int i = 0; i < 20000; ++i) {
+            PHYBER_LOG_INFO("Blocking producer, message %i", i);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    Phyber::Log::stop_async();
+    producer.join();
+    Phyber::Log::set_sink(nullptr);
+
+    // log calls from thread_local destructors after the thread's queue is
+    // gone fall back to the sync path, formatted or deferred
+    CountingSink teardown_sink("Teardown");
+    Phyber::Log::set_sink(&teardown_sink);
+    for (int defer = 0; defer < 2; ++defer) {
+        Phyber::Log::AsyncConfig teardown;
+        teardown.defer_formatting = defer != 0;
+        Phyber::Log::start_async(teardown);
+        std::thread([defer] {
+            static thread_local LogsOnExit on_exit;
+            on_exit.thread = defer;
+            PHYBER_LOG_INFO("Before teardown");
+        }).join();
+        Phyber::Log::stop_async();
+    }
+    Phyber::Log::set_sink(nullptr);
+    const int expected_teardown = Phyber::Log::compiled_in(Phyber::Log::Level::INFO) ? 2 : 0;
+    if (teardown_sink.count != expected_teardown) {
+        fprintf(stderr, "%i log calls made during thread teardown were written, expected %i\n",
+                teardown_sink.count.load(), expected_teardown);
+        return 1;
+    }
+
+    // flight recorder, DEBUG is recorded but not printed. The main thread's
+    // ring overflows and keeps only its newest records
+    Phyber::Log::set_level(Phyber::Log::Level::INFO);
+    Phyber::Log::start_flight_recorder();
+    Phyber::Log::frame_marker(1);
+    for (int i = 0; i < 300; ++i) {
+        PHYBER_LOG_DEBUG("Flight, message %i", i);
+    }
+    std::thread([] { PHYBER_LOG_INFO("Flight, from a thread"); }).join();
+    Phyber::Log::frame_marker(2);
+    const char *flight_path = "phyber_logging_tests.flight";
+    FILE *flight = fopen(flight_path, "wb");
+    bool dumped = flight && Phyber::Log::dump_flight_recorder(fileno(flight));
+    if (flight) { fclose(flight); }
+    Phyber::Log::stop_flight_recorder();
+    Phyber::Log::set_level(Phyber::Log::Level::DEBUG);
+    flight = fopen(flight_path, "rb");
+    count = flight ? Phyber::Log::Binary::decode(flight, stdout) : -1;
+    if (flight) { fclose(flight); }
+    remove(flight_path);
+    const long long main_records = 2 + 300 * Phyber::Log::compiled_in(Phyber::Log::Level::DEBUG);
+    const long long expected_flight = Phyber::Log::compiled_in(Phyber::Log::Level::INFO)
+        + (main_records < PHYBER_ENGINE_LOG_FLIGHT_RECORDS ? main_records : PHYBER_ENGINE_LOG_FLIGHT_RECORDS);
+    if (!dumped || count != expected_flight) {
+        fprintf(stderr, "flight recorder dumped %lld records, expected %lld\n", count, expected_flight);
+        return 1;
+    }
+
+    // arguments too big for a flight slot are marked as truncated
+    if (Phyber::Log::compiled_in(Phyber::Log::Level::INFO)) {
+        char long_arg[300];
+        memset(long_arg, 'a', sizeof(long_arg) - 1);
+        long_arg[sizeof(long_arg) - 1] = '\0';
+        Phyber::Log::set_level(Phyber::Log::Level::WARNING);
+        Phyber::Log::start_flight_recorder();
+        PHYBER_LOG_INFO("Flight, long %s", long_arg);
+        flight = fopen(flight_path, "wb");
+        dumped = flight && Phyber::Log::dump_flight_recorder(fileno(flight));
+        if (flight) { fclose(flight); }
+        Phyber::Log::stop_flight_recorder();
+        Phyber::Log::set_level(Phyber::Log::Level::DEBUG);
+
+        FILE *decoded = tmpfile();
+        flight = fopen(flight_path, "rb");
+        count = flight && decoded ? Phyber::Log::Binary::decode(flight, decoded) : -1;
+        if (flight) { fclose(flight); }
+        remove(flight_path);
+        bool marked = false;
+        char line[1024];
+        if (decoded) {
+            rewind(decoded);
+            while (fgets(line, sizeof(line), decoded)) {
+                marked |= strstr(line, "Flight, long %s [args truncated]") != nullptr;
+            }
+            fclose(decoded);
+        }
+        if (!dumped || count < 1 || !marked) {
+            fprintf(stderr, "truncated flight record is not marked\n");
+            return 1;
+        }
+    }
+
+    // file sink, rotated after every ~200 bytes, keeping two old files
+    Phyber::Log::FileSinkConfig file_config;
+    file_config.max_bytes = 200;
+    file_config.max_files = 2;
+    {
+        Phyber::Log::FileSink file("phyber_logging_tests.log", file_config);
+        Phyber::Log::set_sink(&file);
+        for (int i = 0; i < 6; ++i) {
+            PHYBER_LOG_INFO("File sink, message %i", i);
+            Phyber::Log::flush();
+        }
+        Phyber::Log::set_sink(nullptr);
+    }
+    const char *log_files[] = {"phyber_logging_tests.log", "phyber_logging_tests.log.1", "phyber_logging_tests.log.2"};
+    for (const char *file : log_files) {
+        FILE *f = fopen(file, "rb");
+        // nothing is written when INFO is compiled out
+        if (!f && Phyber::Log::compiled_in(Phyber::Log::Level::INFO)) {
+            fprintf(stderr, "missing rotated log %s\n", file);
+            return 1;
+        }
+        if (f) { fclose(f); }
+        remove(file);
+    }
+
+    // old files are rotated once the current one is too old, even before
+    // the buffer fills up or anything is flushed
+    {
+        Phyber::Log::FileSinkConfig age_config;
+        age_config.max_seconds = 1;
+        age_config.flush_seconds = 0;
+        Phyber::Log::FileSink file("phyber_logging_tests_age.log", age_config);
+        file.write("first\n", 6);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        file.write("second\n", 7);
+        if (!file_exists("phyber_logging_tests_age.log.1")) {
+            fprintf(stderr, "old log was not rotated by age\n");
+            return 1;
+        }
+    }
+    remove("phyber_logging_tests_age.log");
+    remove("phyber_logging_tests_age.log.1");
+
+#if !defined(_WIN32)
+    // while the file can't be opened, write outs only retry opening it and
+    // never rotate away the old files
+    {
+        mkdir("phyber_logging_tests_dir", 0755);
+        Phyber::Log::FileSinkConfig fail_config;
+        fail_config.max_bytes = 10;
+        fail_config.max_files = 2;
+        Phyber::Log::FileSink file("phyber_logging_tests_dir/log", fail_config);
+        file.write("0123456789", 10);
+        file.flush();
+        // the rotation after this write can't open a new file
+        remove("phyber_logging_tests_dir/log");
+        rmdir("phyber_logging_tests_dir");
+        file.write("0123456789", 10);
+        file.flush();
+
+        mkdir("phyber_logging_tests_dir", 0755);
+        mkdir("phyber_logging_tests_dir/log", 0755); // can't be opened for writing
+        FILE *old_file = fopen("phyber_logging_tests_dir/log.2", "wb");
+        if (old_file) {
+            fputs("old", old_file);
+            fclose(old_file);
+        }
+        for (int i = 0; i < 3; ++i) {
+            file.write("0123456789", 10);
+            file.flush();
+        }
+        char old_data[4] = {};
+        old_file = fopen("phyber_logging_tests_dir/log.2", "rb");
+        const bool kept = old_file && fread(old_data, 1, 3, old_file) == 3 && strcmp(old_data, "old") == 0;
+        if (old_file) { fclose(old_file); }
+        // remove() also takes the (empty) directory, wherever it ended up
+        remove("phyber_logging_tests_dir/log");
+        remove("phyber_logging_tests_dir/log.1");
+        remove("phyber_logging_tests_dir/log.2");
+        if (!kept) {
+            fprintf(stderr, "failed opens rotated away old logs\n");
+            return 1;
+        }
+    }
+    remove("phyber_logging_tests_dir/log");
+    remove("phyber_logging_tests_dir/log.1");
+    remove("phyber_logging_tests_dir");
+#endif
+
+    // ring file sink, only the newest bytes are kept
+    {
+        Phyber::Log::RingFileSink ring("phyber_logging_tests.ring", 8);
+        ring.write("0123456789", 10);
+        ring.write("abc", 3);
+        ring.flush();
+    }
+    FILE *ring_file = fopen("phyber_logging_tests.ring", "rb");
+    Phyber::Log::RingFileHeader header;
+    char ring_data[8];
+    bool ring_ok = ring_file && fread(&header, sizeof(header), 1, ring_file) == 1
+        && fread(ring_data, sizeof(ring_data), 1, ring_file) == 1
+        && header.written == 13 && memcmp(ring_data, "89abc567", 8) == 0;
+    if (ring_file) { fclose(ring_file); }
+    remove("phyber_logging_tests.ring");
+    if (!ring_ok) {
+        fprintf(stderr, "ring file sink kept the wrong bytes\n");
+        return 1;
+    }
 }
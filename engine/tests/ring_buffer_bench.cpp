@@ -0,0 +1,77 @@
+#include "phyber/utils/ring_buffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace Phyber;
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static constexpr uint64_t N_ITEMS = 20000000;
+static constexpr size_t CAPACITY = 4096;
+
+static void report(const char *name, size_t batch, int producers, int consumers, double seconds) {
+    printf("%-6s batch=%-3zu producers=%d consumers=%d  %8.2f Mitems/s\n",
+        name, batch, producers, consumers, N_ITEMS / seconds / 1e6);
+}
+
+template <typename Queue>
+static double run(Queue &q, size_t batch, int producers, int consumers) {
+    const uint64_t per_producer = N_ITEMS / producers;
+    const uint64_t total = per_producer * producers;
+    std::atomic<uint64_t> consumed {0};
+    std::vector<std::thread> threads;
+
+    auto start = bench_clock_t::now();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            std::vector<uint64_t> items(batch, 1);
+            for (uint64_t i = 0; i < per_producer; ) {
+                size_t n = per_producer - i < batch ? per_producer - i : batch;
+                size_t pushed = batch == 1 ? q.try_push(items[0]) : q.try_push_n(items.data(), n);
+                if (!pushed) {
+                    std::this_thread::yield();
+                }
+                i += pushed;
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<uint64_t> items(batch);
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                size_t n = batch == 1 ? q.try_pop(items[0]) : q.try_pop_n(items.data(), batch);
+                if (n) {
+                    consumed.fetch_add(n, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+int main() {
+    const size_t batches[] = {1, 16, 64};
+
+    for (size_t batch : batches) {
+        SPSCRingBuffer<uint64_t> q(CAPACITY);
+        report("spsc", batch, 1, 1, run(q, batch, 1, 1));
+    }
+
+    unsigned int hw = std::thread::hardware_concurrency();
+    int max_threads = hw >= 8 ? 4 : (hw >= 4 ? 2 : 1);
+    for (size_t batch : batches) {
+        for (int t = 1; t <= max_threads; t *= 2) {
+            MPMCRingBuffer<uint64_t> q(CAPACITY);
+            report("mpmc", batch, t, t, run(q, batch, t, t));
+        }
+    }
+}
@@ -0,0 +1,295 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "phyber/log/byte_queue.h"
+#include "phyber/utils/ring_buffer.h"
+
+TEST_CASE("SPSCRingBuffer", "[RingBuffer]") {
+    SECTION("capacity rounds up to a power of two") {
+        Phyber::SPSCRingBuffer<int> rb(5);
+        CHECK(rb.capacity() == 8);
+        CHECK(rb.empty());
+    }
+
+    SECTION("push until full then pop in order") {
+        Phyber::SPSCRingBuffer<int> rb(4);
+
+        for (int i = 0; i < 4; ++i) {
+            CHECK(rb.try_push(i));
+        }
+        CHECK_FALSE(rb.try_push(4));
+        CHECK(rb.size_approx() == 4);
+
+        int v;
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(rb.try_pop(v));
+            CHECK(v == i);
+        }
+        CHECK_FALSE(rb.try_pop(v));
+    }
+
+    SECTION("batch push and pop wrap around") {
+        Phyber::SPSCRingBuffer<int> rb(8);
+        int in[6] = {0, 1, 2, 3, 4, 5};
+        int out[8];
+
+        CHECK(rb.try_push_n(in, 6) == 6);
+        CHECK(rb.try_pop_n(out, 4) == 4);
+        CHECK(rb.try_push_n(in, 6) == 6);
+        CHECK(rb.try_push_n(in, 6) == 0);
+
+        CHECK(rb.try_pop_n(out, 8) == 8);
+        CHECK(out[0] == 4);
+        CHECK(out[1] == 5);
+        CHECK(out[2] == 0);
+        CHECK(out[7] == 5);
+    }
+
+    SECTION("non-trivial elements are destroyed") {
+        Phyber::SPSCRingBuffer<std::string> rb(4);
+        rb.try_push(std::string(100, 'a'));
+        rb.try_push(std::string(100, 'b'));
+
+        std::string s;
+        CHECK(rb.try_pop(s));
+        CHECK(s[0] == 'a');
+        // the remaining element is destroyed by the ring buffer destructor
+    }
+
+    SECTION("stress: one producer, one consumer") {
+        constexpr uint64_t N = 1000000;
+        Phyber::SPSCRingBuffer<uint64_t> rb(1024);
+
+        std::thread producer([&] {
+            uint64_t batch[32];
+            uint64_t next = 0;
+            while (next < N) {
+                size_t n = 0;
+                while (n < 32 && next + n < N) {
+                    batch[n] = next + n;
+                    ++n;
+                }
+                size_t pushed = rb.try_push_n(batch, n);
+                if (!pushed) {
+                    std::this_thread::yield();
+                }
+                next += pushed;
+            }
+        });
+
+        uint64_t expected = 0;
+        bool in_order = true;
+        uint64_t out[32];
+        while (expected < N) {
+            size_t n = rb.try_pop_n(out, 32);
+            if (!n) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < n; ++i) {
+                in_order &= out[i] == expected++;
+            }
+        }
+        producer.join();
+
+        CHECK(in_order);
+        CHECK(rb.empty());
+    }
+}
+
+TEST_CASE("MPMCRingBuffer", "[RingBuffer]") {
+    SECTION("push until full then pop in order") {
+        Phyber::MPMCRingBuffer<int> rb(4);
+
+        for (int i = 0; i < 4; ++i) {
+            CHECK(rb.try_push(i));
+        }
+        CHECK_FALSE(rb.try_push(4));
+
+        int v;
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(rb.try_pop(v));
+            CHECK(v == i);
+        }
+        CHECK_FALSE(rb.try_pop(v));
+    }
+
+    SECTION("batch operations are limited by free space") {
+        Phyber::MPMCRingBuffer<int> rb(8);
+        int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        int out[10];
+
+        CHECK(rb.try_push_n(in, 10) == 8);
+        CHECK(rb.try_pop_n(out, 3) == 3);
+        CHECK(out[2] == 2);
+        CHECK(rb.try_push_n(in, 10) == 3);
+        CHECK(rb.try_pop_n(out, 10) == 8);
+        CHECK(out[0] == 3);
+        CHECK(out[5] == 0);
+    }
+
+    SECTION("stress: many producers, many consumers") {
+        constexpr int PRODUCERS = 4;
+        constexpr int CONSUMERS = 4;
+        constexpr uint64_t PER_PRODUCER = 200000;
+        Phyber::MPMCRingBuffer<uint64_t> rb(256);
+
+        std::atomic<uint64_t> consumed {0};
+        std::atomic<uint64_t> sum {0};
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < PRODUCERS; ++p) {
+            threads.emplace_back([&, p] {
+                for (uint64_t i = 0; i < PER_PRODUCER; ) {
+                    if (p % 2 == 0) {
+                        uint64_t batch[8];
+                        size_t n = 0;
+                        while (n < 8 && i + n < PER_PRODUCER) {
+                            batch[n] = i + n + 1;
+                            ++n;
+                        }
+                        size_t pushed = rb.try_push_n(batch, n);
+                        if (!pushed) {
+                            std::this_thread::yield();
+                        }
+                        i += pushed;
+                    } else if (rb.try_push(i + 1)) {
+                        ++i;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int c = 0; c < CONSUMERS; ++c) {
+            threads.emplace_back([&, c] {
+                uint64_t out[8];
+                while (consumed.load(std::memory_order_relaxed) < PRODUCERS * PER_PRODUCER) {
+                    size_t n = c % 2 == 0 ? rb.try_pop_n(out, 8) : rb.try_pop(out[0]);
+                    if (!n) {
+                        std::this_thread::yield();
+                    }
+                    uint64_t local = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        local += out[i];
+                    }
+                    sum.fetch_add(local, std::memory_order_relaxed);
+                    consumed.fetch_add(n, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+
+        CHECK(consumed.load() == PRODUCERS * PER_PRODUCER);
+        CHECK(sum.load() == PRODUCERS * (PER_PRODUCER * (PER_PRODUCER + 1) / 2));
+        CHECK(rb.empty());
+    }
+}
+
+TEST_CASE("ByteQueue", "[RingBuffer]") {
+    SECTION("variable sized messages in order") {
+        Phyber::Log::ByteQueue q(256);
+        CHECK(q.capacity() == 256);
+        CHECK(q.empty());
+
+        for (int i = 0; i < 3; ++i) {
+            char *p = static_cast<char *>(q.reserve(10 + i));
+            REQUIRE(p);
+            memset(p, 'a' + i, 10 + i);
+            q.commit();
+        }
+        for (int i = 0; i < 3; ++i) {
+            size_t size;
+            const char *p = static_cast<const char *>(q.peek(size));
+            REQUIRE(p);
+            CHECK(size >= size_t(10 + i));
+            CHECK(p[0] == 'a' + i);
+            CHECK(p[9 + i] == 'a' + i);
+            q.pop();
+        }
+        size_t size;
+        CHECK(q.peek(size) == nullptr);
+        CHECK(q.empty());
+    }
+
+    SECTION("full queue and oversized messages") {
+        Phyber::Log::ByteQueue q(256);
+        CHECK(q.reserve(q.max_message() + 1) == nullptr);
+
+        int pushed = 0;
+        while (q.reserve(56)) {
+            q.commit();
+            ++pushed;
+        }
+        CHECK(pushed == 4);
+    }
+
+    SECTION("commit keeps only the used part") {
+        Phyber::Log::ByteQueue q(256);
+        REQUIRE(q.reserve(100));
+        q.commit(4);
+        REQUIRE(q.reserve(100));
+        q.commit(4);
+        size_t size;
+        REQUIRE(q.peek(size));
+        CHECK(size == 8);
+    }
+
+    SECTION("messages wrap around the end") {
+        Phyber::Log::ByteQueue q(256);
+        for (int i = 0; i < 100; ++i) {
+            uint32_t *p = static_cast<uint32_t *>(q.reserve(40 + (i % 3) * 16));
+            REQUIRE(p);
+            *p = i;
+            q.commit();
+
+            size_t size;
+            const uint32_t *r = static_cast<const uint32_t *>(q.peek(size));
+            REQUIRE(r);
+            CHECK(*r == uint32_t(i));
+            q.pop();
+        }
+    }
+
+    SECTION("producer and consumer threads") {
+        Phyber::Log::ByteQueue q(4096);
+        const uint32_t count = 200000;
+
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < count; ) {
+                size_t words = 1 + i % 7;
+                uint32_t *p = static_cast<uint32_t *>(q.reserve(words * sizeof(uint32_t)));
+                if (!p) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t w = 0; w < words; ++w) { p[w] = i; }
+                q.commit(words * sizeof(uint32_t));
+                ++i;
+            }
+        });
+
+        bool ok = true;
+        for (uint32_t expected = 0; expected < count; ) {
+            size_t size;
+            const uint32_t *p = static_cast<const uint32_t *>(q.peek(size));
+            if (!p) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t w = 0; w < 1 + expected % 7; ++w) { ok &= p[w] == expected; }
+            q.pop();
+            ++expected;
+        }
+        producer.join();
+        CHECK(ok);
+    }
+}
@@ -0,0 +1,44 @@
+#include "phyber/log/binary.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// turns a binary log back into the regular text output:
+//   phyber_logdecode [--json] <log file> [output file]
+// "-" reads from stdin, the output goes to stdout by default. --json writes
+// JSON Lines instead
+int main(int argc, char **argv) {
+    Phyber::Log::Format format = Phyber::Log::Format::TEXT;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--json") == 0) {
+        format = Phyber::Log::Format::JSON;
+        ++arg;
+    }
+    if (argc - arg < 1 || argc - arg > 2) {
+        fprintf(stderr, "usage: %s [--json] <log file | -> [output file]\n", argv[0]);
+        return 2;
+    }
+    const char *in_path = argv[arg];
+    const char *out_path = argc - arg == 2 ? argv[arg + 1] : nullptr;
+
+    FILE *in = strcmp(in_path, "-") == 0 ? stdin : fopen(in_path, "rb");
+    if (!in) {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], in_path);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "wb") : stdout;
+    if (!out) {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], out_path);
+        return 1;
+    }
+
+    long long count = Phyber::Log::Binary::decode(in, out, format);
+    if (in != stdin) { fclose(in); }
+    if (out != stdout) { fclose(out); }
+
+    if (count < 0) {
+        fprintf(stderr, "%s: %s is not a binary log or is cut off\n", argv[0], in_path);
+        return 1;
+    }
+    return 0;
+}